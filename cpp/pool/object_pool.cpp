@@ -1,11 +1,25 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <iostream>
-#include <list>
 #include <memory>
 #include <mutex>
 #include <new>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
+#include <sys/mman.h>
+#include <unistd.h>
+
 // NOTE: 侵入式链表 (union 实现)
 // 当内存块空闲时，它是一个指向下一个空闲节点的指针
 // 当被使用时，它是一段「未初始化的内存」，用于存储对象 T
@@ -25,24 +39,357 @@
 // 为了确保对象池的存活时间至少和所有从它分配出去的对象的存活时间一样长
 // 否则会出现对象池已经销毁了(pool_=nullptr), 但是却在删除器中调用了 pool_ 指针
 
-template <typename T, size_t ChunkSize = 128>
-class ObjectPool : public std::enable_shared_from_this<ObjectPool<T, ChunkSize>> {
+// v3: 并发策略(编译期选择)
+// 所有线程同时 Allocate/Deallocate 时, 全局 mtx_ 成为热点
+// ThreadCached: 每个线程持有一个小的本地空闲链表(弹匣 magazine),
+// 只有弹匣空了(整批取)或满了(整批还)才去碰全局空闲链表和 mtx_
+// LockFree: 空闲链表换成带 ABA 标签的 Treiber 无锁栈, mtx_ 只用来串行化 Grow
+// 持锁线程被抢占时不会再让其他线程一起等(长尾延迟)
+
+// v4: 紧凑句柄 CompactPtr
+// UniquePtr 的 Deleter 持有 shared_ptr: 每次分配 shared_from_this() + 归还时析构,
+// 两次引用计数原子操作, 句柄也有 24 字节
+// CompactPtr 的删除器无状态: 内存块按 kChunkBytes 对齐, 对象地址向下取整就是块头,
+// 块头里记着所属的池. 池用一个计数器 refs_ 记录「所有者 + 存活的紧凑对象」,
+// 计数归零时才真正析构, 因此生命周期保证不变, 句柄只有一个指针大小
+
+// v5: 可配置的扩容策略与内存块来源 (PoolOptions)
+// 每次扩容申请一段连续的区域(region), 区域内切成若干对齐的内存块
+// 扩容多少块由 growth 决定; 区域可以来自堆, 也可以来自 mmap(可选 MADV_HUGEPAGE 降低 TLB miss)
+// Reserve(n) 在启动时一次性备好 n 个对象的空间
+
+// v6: 收缩 Trim
+// 流量高峰过后, 扩容得到的内存一直留在池里直到池销毁, 常驻内存降不下来
+// Trim() 统计每个块有多少节点在空闲链表上, 把全部空闲的内存从空闲链表摘掉并还给系统;
+// 归还粒度: kMmap 按对齐单位(页或大页, 不小于一个块) munmap 区域中的一部分;
+// kHeap 默认一次扩容就是一次堆分配, 只能整段归还; 打开 separate_heap_chunks 后每个块单独分配,
+// 可以逐块归还
+// StartBackgroundTrim(interval) 在后台线程里定期执行 Trim
+// NOTE: LockFree 策略不支持 Trim: 并发 Pop 可能正在读一个已弹出节点的 next,
+// 内存一旦归还就会访问非法地址
+
+// v7: 统计与调试 (编译期开关, 关闭时没有任何运行期开销)
+// -DOBJECT_POOL_STATS=1: 存活对象数、历史峰值、扩容次数、等待 mtx_ 的累计时间, 见 Stats()
+// -DOBJECT_POOL_DEBUG=1: 归还的槽位填充 0xDD, 检测重复 Deallocate、归还非本池对象,
+// 以及分配时发现槽位被写过(释放后使用), 发现问题打印后 abort
+#ifndef OBJECT_POOL_STATS
+#define OBJECT_POOL_STATS 0
+#endif
+
+#ifndef OBJECT_POOL_DEBUG
+#define OBJECT_POOL_DEBUG 0
+#endif
+
+namespace pool_policy {
+
+// 单把全局互斥锁保护空闲链表 (v2 的做法)
+struct Locked {};
+
+// 线程本地弹匣 + 全局空闲链表
+// MagazineSize: 弹匣容量, 每次与全局链表交换 MagazineSize / 2 个节点
+template <size_t MagazineSize = 64>
+struct ThreadCached {
+    static_assert(MagazineSize >= 2, "MagazineSize must be at least 2.");
+    static constexpr size_t kMagazineSize = MagazineSize;
+    static constexpr size_t kBatchSize = MagazineSize / 2;
+};
+
+// 无锁空闲链表 (tagged pointer CAS)
+struct LockFree {};
+
+template <typename P>
+inline constexpr bool kIsThreadCached = false;
+
+template <size_t M>
+inline constexpr bool kIsThreadCached<ThreadCached<M>> = true;
+
+}  // namespace pool_policy
+
+// 扩容策略: 输入当前总块数, 返回这次要新增的块数, 返回 0 表示不允许再扩容(Allocate 抛 bad_alloc)
+namespace pool_growth {
+
+// 每次固定新增 chunks 块 (默认 1 块, 即线性增长)
+struct Fixed {
+    size_t chunks = 1;
+
+    size_t operator()(size_t /*total_chunks*/) const { return chunks; }
+};
+
+// 每次扩容后总块数变为原来的 factor 倍
+struct Geometric {
+    double factor = 2.0;
+
+    size_t operator()(size_t total_chunks) const {
+        auto grown = static_cast<size_t>(static_cast<double>(total_chunks) * (factor - 1.0));
+        return std::max<size_t>(grown, 1);
+    }
+};
+
+// 给任意策略加上总块数上限
+template <typename Inner>
+struct Capped {
+    Inner inner;
+    size_t max_chunks;
+
+    size_t operator()(size_t total_chunks) const {
+        if (total_chunks >= max_chunks) {
+            return 0;
+        }
+        return std::min(inner(total_chunks), max_chunks - total_chunks);
+    }
+};
+
+}  // namespace pool_growth
+
+// ObjectPool::Stats() 的返回值, 仅 OBJECT_POOL_STATS 打开时可用
+struct PoolStats {
+    size_t live;                         // 当前存活对象数
+    size_t high_water;                   // 存活对象数的历史峰值
+    size_t grow_count;                   // 扩容次数 (Reserve 也算一次)
+    std::chrono::nanoseconds lock_wait;  // 所有线程等待 mtx_ 的累计时间
+};
+
+// 统计计数器: 关闭 OBJECT_POOL_STATS 时是空类型, 所有埋点都是空的内联函数
+// NOTE: 池用 [[no_unique_address]] 持有它, 关闭时不占空间
+template <bool kEnabled>
+struct StatsCounters {
+    void OnAllocate() noexcept {}
+    void OnDeallocate() noexcept {}
+    void OnGrow() noexcept {}
+    void OnLockWait(std::chrono::nanoseconds) noexcept {}
+    PoolStats Snapshot() const noexcept { return {}; }
+};
+
+template <>
+struct StatsCounters<true> {
+    std::atomic<size_t> live{0};
+    std::atomic<size_t> high_water{0};
+    std::atomic<size_t> grow_count{0};
+    std::atomic<int64_t> lock_wait_ns{0};
+
+    void OnAllocate() noexcept {
+        size_t now = live.fetch_add(1, std::memory_order_relaxed) + 1;
+        size_t peak = high_water.load(std::memory_order_relaxed);
+        while (now > peak &&
+               !high_water.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+        }
+    }
+
+    void OnDeallocate() noexcept { live.fetch_sub(1, std::memory_order_relaxed); }
+
+    void OnGrow() noexcept { grow_count.fetch_add(1, std::memory_order_relaxed); }
+
+    void OnLockWait(std::chrono::nanoseconds waited) noexcept {
+        lock_wait_ns.fetch_add(waited.count(), std::memory_order_relaxed);
+    }
+
+    PoolStats Snapshot() const noexcept {
+        return {live.load(std::memory_order_relaxed), high_water.load(std::memory_order_relaxed),
+                grow_count.load(std::memory_order_relaxed),
+                std::chrono::nanoseconds{lock_wait_ns.load(std::memory_order_relaxed)}};
+    }
+};
+
+// 内存块的来源
+enum class ChunkBackend {
+    kHeap,  // operator new, 按块大小对齐
+    kMmap,  // 匿名 mmap, 按页(或大页)对齐
+};
+
+struct PoolOptions {
+    std::function<size_t(size_t)> growth = pool_growth::Fixed{};
+    ChunkBackend backend = ChunkBackend::kHeap;
+    bool huge_pages = false;  // 仅 kMmap 有效: 区域按 2MB 对齐并 madvise(MADV_HUGEPAGE)
+    // 仅 kHeap 有效: 每个块单独一次堆分配, Trim 可以逐块归还;
+    // 默认一次扩容整段分配(分配次数少、块连续), 但只有整段都空闲时 Trim 才能归还
+    bool separate_heap_chunks = false;
+};
+
+template <typename T, size_t ChunkSize = 128, typename Policy = pool_policy::Locked>
+class ObjectPool : public std::enable_shared_from_this<ObjectPool<T, ChunkSize, Policy>> {
 private:
     static_assert(ChunkSize > 0, "ChunkSize must be greater than 0.");
+    static constexpr bool kThreadCached = pool_policy::kIsThreadCached<Policy>;
+    static constexpr bool kLockFree = std::is_same_v<Policy, pool_policy::LockFree>;
+    static constexpr bool kStats = OBJECT_POOL_STATS;
+    static constexpr bool kDebug = OBJECT_POOL_DEBUG;
+
+#if OBJECT_POOL_DEBUG
+    // 调试模式: 每个节点额外带一个状态字, 用来识别重复归还和非本池指针
+    // NOTE: storage 必须位于偏移 0, T* 和 Node* 之间才能直接 reinterpret_cast
+    struct Node {
+        union {
+            Node* next;
+            alignas(T) std::byte storage[sizeof(T)];
+        };
+        uint32_t state;  // kSlotFree / kSlotLive, 通过 atomic_ref 访问
+    };
+#else
     // 侵入型链表
     union Node {
         Node* next;
         alignas(T) std::byte storage[sizeof(T)];  // 按照 sizeof(T) 进行内存对齐
     };
+#endif
+
+    // 内存块: 块头 + 若干节点, 一次堆分配, 起始地址按 kChunkBytes 对齐
+    // NOTE: kChunkBytes 是 2 的幂, 任意节点地址 & ~(kChunkBytes - 1) 就是块头
+    struct ChunkHeader {
+        ObjectPool* pool;   // 所属的池, 供 CompactDeleter 使用
+        size_t free_nodes;  // 本块在空闲链表上的节点数, 仅在 Trim 中(持锁)统计
+    };
+
+    static constexpr size_t kHeaderBytes =
+        (sizeof(ChunkHeader) + alignof(Node) - 1) / alignof(Node) * alignof(Node);
+    static constexpr size_t kChunkBytes = std::bit_ceil(kHeaderBytes + ChunkSize * sizeof(Node));
+    // NOTE: 向上取整到 2 的幂后多出来的空间也用来放节点, 所以每块实际节点数 >= ChunkSize
+    static constexpr size_t kNodesPerChunk = (kChunkBytes - kHeaderBytes) / sizeof(Node);
+
+    // 一次扩容得到的连续区域, 包含一个或多个内存块
+    struct Region {
+        void* base;
+        size_t bytes;
+        ChunkBackend backend;
+    };
+
+    static constexpr size_t kHugePageSize = size_t{2} << 20;
+
+    const PoolOptions options_;
+    std::vector<Region> regions_;  // 受 mtx_ 保护, 池析构时统一释放
+    size_t chunk_count_{0};        // 受 mtx_ 保护
+    size_t capacity_{0};           // 总节点数, 受 mtx_ 保护
 
-    // 存储所有节点的连续内存
-    // NOTE: 本来就要在堆上分配, 那直接 Node 别 void* 了
-    std::list<std::vector<Node>> pool_chunks_;
+    std::atomic<size_t> reclaimed_bytes_{0};  // Trim 累计归还给系统的字节数
+
+    // 统计计数器, 关闭 OBJECT_POOL_STATS 时是空类型, no_unique_address 让它不占空间
+    [[no_unique_address]] mutable StatsCounters<kStats> stats_;
+
+    static constexpr uint32_t kSlotFree = 0xF7EEF7EE;
+    static constexpr uint32_t kSlotLive = 0x11FE11FE;
+    static constexpr std::byte kPoison{0xDD};
+    std::condition_variable_any trim_cv_;
+    std::jthread trimmer_;  // 后台 Trim 线程, 未开启时为空
+
+    // 带 ABA 标签的 Treiber 栈, 仅 LockFree 策略使用
+    // 64 位字: 低 48 位是节点地址, 高 16 位是标签, 每次成功 CAS 标签 +1
+    // NOTE: 节点 A 被弹出又压回(A->B->A)时地址相同但标签不同, 旧的 CAS 会失败
+    // 16 位标签只有在一次 Pop 的窗口内恰好发生 65536 次修改才会回绕, 实际中可忽略
+    // NOTE: 要求节点地址的高 16 位全为 0. 57 位虚拟地址(5 级页表)或带顶字节标签(ARM TBI/MTE)的
+    // 指针不满足这一点, 高位会被标签覆盖; 扩容时用 CanHold 检查, 不满足就释放区域并抛 bad_alloc
+    class TaggedFreeList {
+    public:
+        // [0, end) 内的所有地址都能装进低 48 位
+        static bool CanHold(const void* end) noexcept {
+            return (reinterpret_cast<uintptr_t>(end) >> kTagShift) == 0;
+        }
+
+        bool Empty() const noexcept {
+            return Ptr(head_.load(std::memory_order_acquire)) == nullptr;
+        }
+
+        Node* Pop() noexcept {
+            uint64_t old_head = head_.load(std::memory_order_acquire);
+            while (Node* node = Ptr(old_head)) {
+                // NOTE: node 可能已被其他线程弹出并构造成 T, 此时读到的 next 是垃圾值,
+                // 但那样的话 head_ 的标签一定变了, 下面的 CAS 会失败并重试.
+                // 内存块直到池销毁才释放, 所以这次读不会访问到已归还给系统的内存
+                Node* next = std::atomic_ref{node->next}.load(std::memory_order_relaxed);
+                if (head_.compare_exchange_weak(old_head, Pack(next, old_head),
+                                                std::memory_order_acquire,
+                                                std::memory_order_acquire)) {
+                    return node;
+                }
+            }
+            return nullptr;
+        }
+
+        // 把 first -> ... -> last 整条链一次性压入
+        void PushChain(Node* first, Node* last) noexcept {
+            uint64_t old_head = head_.load(std::memory_order_relaxed);
+            do {
+                std::atomic_ref{last->next}.store(Ptr(old_head), std::memory_order_relaxed);
+            } while (!head_.compare_exchange_weak(old_head, Pack(first, old_head),
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed));
+        }
+
+    private:
+        static_assert(sizeof(void*) == 8, "TaggedFreeList assumes 64-bit pointers.");
+        static constexpr int kTagShift = 48;
+        static constexpr uint64_t kPtrMask = (uint64_t{1} << kTagShift) - 1;
+
+        static Node* Ptr(uint64_t v) noexcept { return reinterpret_cast<Node*>(v & kPtrMask); }
+
+        // 新值 = 新地址 + (旧标签 + 1)
+        static uint64_t Pack(Node* p, uint64_t old_value) noexcept {
+            uint64_t tag = (old_value >> kTagShift) + 1;
+            return (tag << kTagShift) | reinterpret_cast<uint64_t>(p);
+        }
+
+        std::atomic<uint64_t> head_{0};
+    };
 
     // 指向空闲链表的头部
     Node* free_list_head_{nullptr};
+    TaggedFreeList lock_free_head_;  // LockFree 策略下代替 free_list_head_
+
+    mutable std::mutex mtx_;
 
-    std::mutex mtx_;
+private:
+    // 线程本地弹匣: 一个线程在一个池上的私有空闲链表
+    // NOTE: 由池(magazines_)和线程(LocalMagazines)共同持有, 谁先离开谁打标记
+    struct Magazine {
+        Node* head{nullptr};
+        size_t count{0};
+        std::atomic<bool> orphaned{false};   // 所属线程已退出, 池可以回收其中的节点
+        std::atomic<bool> pool_dead{false};  // 池已销毁, 线程可以丢弃这一项
+    };
+
+    // 每个线程持有的「池 id -> 弹匣」表
+    // NOTE: 用单调递增的 id 而不是 this 做键, 池销毁后地址可能被新池复用
+    struct ThreadMagazines {
+        struct Entry {
+            uint64_t pool_id;
+            std::shared_ptr<Magazine> magazine;
+        };
+        std::vector<Entry> entries;
+        uint64_t cached_id{0};  // 最近一次命中的池, 绝大多数情况下只用到这一项
+        Magazine* cached{nullptr};
+
+        ~ThreadMagazines() {
+            // 线程退出: 弹匣中的节点不在这里归还(池可能已经不在了), 交给池下次缺货时回收
+            for (auto& e : entries) {
+                e.magazine->orphaned.store(true, std::memory_order_release);
+            }
+            TlsDestroyed() = true;
+        }
+    };
+
+    // NOTE: 线程退出时, 比弹匣表更晚析构的 thread_local 对象仍可能归还池对象,
+    // 那时弹匣表已经析构, 不能再访问. 这个标记是平凡类型, 没有析构函数, 线程退出的任何阶段都可以读
+    static bool& TlsDestroyed() noexcept {
+        thread_local bool destroyed = false;
+        return destroyed;
+    }
+
+    // 当前线程的弹匣表, 已析构时返回 nullptr
+    static ThreadMagazines* LocalTable() noexcept {
+        if (TlsDestroyed()) {
+            return nullptr;
+        }
+        thread_local ThreadMagazines tls;
+        return &tls;
+    }
+
+    // 池 id 从 1 开始, 0 表示 cached 为空
+    static inline std::atomic<uint64_t> next_pool_id_{1};
+    const uint64_t pool_id_{next_pool_id_.fetch_add(1, std::memory_order_relaxed)};
+
+    // 本池登记过的所有弹匣, 受 mtx_ 保护
+    std::vector<std::shared_ptr<Magazine>> magazines_;
+
+    // 1 (所有 shared_ptr 所有者共用一份) + 存活的 CompactPtr 对象数
+    std::atomic<size_t> refs_{1};
 
 private:
     // 自定义删除器 (有状态!)
@@ -58,15 +405,46 @@ private:
         }
     };
 
+    // 无状态删除器: 从对象地址找回块头, 再找回池
+    struct CompactDeleter {
+        void operator()(T* p) const noexcept {
+            if (p) {
+                ChunkOf(p)->pool->DeallocateCompact(p);
+            }
+        }
+    };
+
+    // shared_ptr 所有者全部释放时调用, 此时可能仍有 CompactPtr 存活
+    struct Releaser {
+        void operator()(ObjectPool* pool) const noexcept { pool->Release(); }
+    };
+
 public:
     using UniquePtr = std::unique_ptr<T, Deleter>;
+    using CompactPtr = std::unique_ptr<T, CompactDeleter>;
 
-    static std::shared_ptr<ObjectPool> Create() {
+    static std::shared_ptr<ObjectPool> Create(PoolOptions options = {}) {
         // NOTE: std::make_shared 无法访问私有构造函数, 而 new 可以
-        return std::shared_ptr<ObjectPool>{new ObjectPool{}};
+        // NOTE: 不直接 delete, 而是交给 Releaser 判断还有没有存活的紧凑对象
+        return std::shared_ptr<ObjectPool>{new ObjectPool{std::move(options)}, Releaser{}};
     }
 
-    ~ObjectPool() = default;
+    ~ObjectPool() {
+        // NOTE: 先停掉后台 Trim, 它可能正在访问 regions_ 和空闲链表
+        if (trimmer_.joinable()) {
+            trimmer_.request_stop();
+            trimmer_.join();
+        }
+        if constexpr (kThreadCached) {
+            // 通知仍存活的线程: 它们手里属于本池的弹匣已经失效
+            for (auto& m : magazines_) {
+                m->pool_dead.store(true, std::memory_order_release);
+            }
+        }
+        for (const Region& region : regions_) {
+            FreeRegion(region);
+        }
+    }
 
     // 禁止拷贝和移动
     ObjectPool(const ObjectPool&) = delete;
@@ -74,31 +452,147 @@ public:
 
 private:
     // 私有构造函数, 强制使用 Create
-    ObjectPool() {
-        Grow();  // 初始化时分配第一个块
+    explicit ObjectPool(PoolOptions options) : options_(std::move(options)) {
+        Grow();  // 初始化时按扩容策略分配第一批块
     }
 
 public:
-    // 分配一个对象
-    // 使用 placement new 在获取的内存上构造对象
-    template <typename... Args>
-    [[nodiscard]] UniquePtr Allocate(Args&&... args) {
-        Node* curr_node{nullptr};
+    // 预留至少 n 个对象的容量
+    // NOTE: 不受扩容策略限制, 缺多少一次性申请成一段连续区域;
+    // 串空闲链表时会写遍每个节点, 顺带完成预缺页(pre-fault), 避免运行时再触发缺页
+    void Reserve(size_t n) {
+        auto lk = Lock();
+        if (capacity_ < n) {
+            GrowChunks((n - capacity_ + kNodesPerChunk - 1) / kNodesPerChunk);
+        }
+    }
+
+    // 当前总容量 (对象个数)
+    size_t Capacity() const {
+        auto lk = Lock();
+        return capacity_;
+    }
+
+    // 把完全空闲的内存还给系统, 返回这次归还的字节数
+    // 归还粒度: kMmap 区域是对齐单位(见 MmapAlign), 一段区域可以只归还其中一部分;
+    // kHeap 区域只能整段归还 (打开 separate_heap_chunks 时一段区域就是一个块)
+    // NOTE: 需要遍历空闲链表, 代价 O(空闲节点数 + 块数), 全程持有 mtx_;
+    // 还留在其他线程弹匣里的节点不算空闲, 对应的块不会被回收
+    size_t Trim() {
+        static_assert(!kLockFree, "Trim is not supported with pool_policy::LockFree.");
+
+        size_t released = 0;
         {
-            std::lock_guard lk{mtx_};
-            // TODO: 扩容策略?
-            if (free_list_head_ == nullptr) {
-                Grow();
+            auto lk = Lock();
+            if constexpr (kThreadCached) {
+                ReclaimOrphans();
             }
 
-            curr_node = free_list_head_;              // 获取头节点
-            free_list_head_ = free_list_head_->next;  // 更新头节点(可能会变成nullptr->扩容)
+            // 1. 统计每个块在空闲链表上的节点数
+            for (const Region& region : regions_) {
+                ForEachChunk(region, [](ChunkHeader* chunk) { chunk->free_nodes = 0; });
+            }
+            for (Node* node = free_list_head_; node != nullptr; node = node->next) {
+                ++ChunkOf(node)->free_nodes;
+            }
+
+            // 2. 把每段区域按归还单位切开, 连续的全空闲单位合成一段待回收区域, 其余部分保留
+            std::vector<Region> kept;
+            std::vector<Region> victims;
+            for (const Region& region : regions_) {
+                const size_t unit =
+                    region.backend == ChunkBackend::kMmap ? MmapAlign() : region.bytes;
+                auto* base = static_cast<std::byte*>(region.base);
+                auto piece = [&](size_t first, size_t last) {
+                    return Region{base + first * unit, (last - first) * unit, region.backend};
+                };
+                auto unit_free = [&](size_t i) {
+                    bool all_free = true;
+                    ForEachChunk(piece(i, i + 1), [&](ChunkHeader* chunk) {
+                        all_free = all_free && chunk->free_nodes == kNodesPerChunk;
+                    });
+                    return all_free;
+                };
+
+                const size_t units = region.bytes / unit;
+                bool free = unit_free(0);
+                for (size_t begin = 0; begin < units;) {
+                    size_t end = begin + 1;
+                    bool next_free = free;
+                    while (end < units && (next_free = unit_free(end)) == free) {
+                        ++end;
+                    }
+                    (free ? victims : kept).push_back(piece(begin, end));
+                    begin = end;
+                    free = next_free;
+                }
+            }
+            if (victims.empty()) {
+                return 0;
+            }
+            // 用 free_nodes = 0 标记「待回收」(这些块的节点都在空闲链表上, 不会与真正的 0 混淆)
+            for (const Region& region : victims) {
+                ForEachChunk(region, [](ChunkHeader* chunk) { chunk->free_nodes = 0; });
+            }
+            regions_ = std::move(kept);
+
+            // 3. 把待回收区域的节点从空闲链表摘掉(保持其余节点的顺序)
+            Node** link = &free_list_head_;
+            while (*link != nullptr) {
+                if (ChunkOf(*link)->free_nodes == 0) {
+                    *link = (*link)->next;
+                } else {
+                    link = &(*link)->next;
+                }
+            }
+
+            // 4. 归还内存
+            for (const Region& region : victims) {
+                const size_t chunks = region.bytes / kChunkBytes;
+                chunk_count_ -= chunks;
+                capacity_ -= chunks * kNodesPerChunk;
+                released += region.bytes;
+                FreeRegion(region);
+            }
         }
+        reclaimed_bytes_.fetch_add(released, std::memory_order_relaxed);
+        return released;
+    }
 
-        // C++20 std::construct_at 替代 placement new
-        // NOTE: &storage: 指向数组的指针 std::byte(*)[sizeof(T)], 含义更明确
-        T* p_obj = std::construct_at(reinterpret_cast<T*>(&curr_node->storage),
-                                     std::forward<Args>(args)...);
+    // 开启后台 Trim: 每隔 interval 执行一次, 池析构时自动停止
+    void StartBackgroundTrim(std::chrono::milliseconds interval) {
+        static_assert(!kLockFree, "Trim is not supported with pool_policy::LockFree.");
+        if (trimmer_.joinable()) {
+            return;
+        }
+        trimmer_ = std::jthread{[this, interval](std::stop_token st) {
+            std::mutex sleep_mtx;
+            std::unique_lock lk{sleep_mtx};
+            // NOTE: wait_for 带 stop_token, request_stop 时立即醒来, 谓词返回 true 后退出
+            while (!trim_cv_.wait_for(lk, st, interval, [&st] { return st.stop_requested(); })) {
+                Trim();
+            }
+        }};
+    }
+
+    // Trim 累计归还给系统的字节数 (包含后台 Trim)
+    size_t ReclaimedBytes() const noexcept {
+        return reclaimed_bytes_.load(std::memory_order_relaxed);
+    }
+
+    // 统计快照, 需要 -DOBJECT_POOL_STATS=1
+    PoolStats Stats() const noexcept {
+        // NOTE: sizeof(T) 让断言依赖模板参数, 只有真正调用 Stats() 时才检查
+        static_assert(sizeof(T) > 0 && kStats,
+                      "Compile with -DOBJECT_POOL_STATS=1 to enable ObjectPool::Stats().");
+        return stats_.Snapshot();
+    }
+
+    // 分配一个对象
+    // 使用 placement new 在获取的内存上构造对象
+    template <typename... Args>
+    [[nodiscard]] UniquePtr Allocate(Args&&... args) {
+        T* p_obj = Construct(std::forward<Args>(args)...);
 
         // NOTE: Deleter 对象传入 ObjectPool shared_from_this 指针
         // NOTE: this-> 将名称查找推迟到第二阶段: 模板实例化时
@@ -109,43 +603,442 @@ public:
         return UniquePtr{p_obj, Deleter{this->shared_from_this()}};
     }
 
+    // 分配一个对象, 返回指针大小的句柄
+    // NOTE: 只能由 CompactPtr 归还, 不要对它手动调用 Deallocate
+    template <typename... Args>
+    [[nodiscard]] CompactPtr AllocateCompact(Args&&... args) {
+        T* p_obj = Construct(std::forward<Args>(args)...);
+        // NOTE: 调用者手里有池的 shared_ptr, refs_ 此时至少为 1, relaxed 即可
+        refs_.fetch_add(1, std::memory_order_relaxed);
+        return CompactPtr{p_obj};
+    }
+
     // 归还一个对象
     void Deallocate(T* p) noexcept {
         if (p == nullptr) {
             return;
         }
 
+        // 将对象的内存重新解释为 Node 指针
+        Node* node = reinterpret_cast<Node*>(p);
+        if constexpr (kDebug) {
+            CheckDeallocate(node);  // NOTE: 必须在析构之前, 重复归还时对象已经析构过了
+        }
+
         // NOTE: 显式调用析构函数 C++20 std::destroy_at
         std::destroy_at(p);
 
-        // NOTE: 析构后, 内存还给池, 被 vector 管理
+        // NOTE: 析构后, 内存还给池
+        if constexpr (kDebug) {
+            std::memset(&node->storage, std::to_integer<int>(kPoison), sizeof(T));
+        }
+        stats_.OnDeallocate();
+        PushNode(node);
+    }
 
-        // 将对象的内存重新解释为 Node 指针
-        Node* node = reinterpret_cast<Node*>(p);
+private:
+    // 取一个空闲节点并在其上构造对象
+    template <typename... Args>
+    T* Construct(Args&&... args) {
+        Node* curr_node{PopNode()};
+        if constexpr (kDebug) {
+            CheckAllocate(curr_node);
+        }
+        T* p_obj{nullptr};
+        try {
+            // C++20 std::construct_at 替代 placement new
+            // NOTE: &storage: 指向数组的指针 std::byte(*)[sizeof(T)], 含义更明确
+            p_obj = std::construct_at(reinterpret_cast<T*>(&curr_node->storage),
+                                      std::forward<Args>(args)...);
+        } catch (...) {
+            if constexpr (kDebug) {
+                Poison(curr_node);
+            }
+            PushNode(curr_node);  // 构造失败, 节点还回去
+            throw;
+        }
+        stats_.OnAllocate();
+        return p_obj;
+    }
+
+    // 加锁; 打开统计时, 拿不到锁的那部分等待时间计入 lock_wait
+    std::unique_lock<std::mutex> Lock() const {
+        if constexpr (kStats) {
+            std::unique_lock lk{mtx_, std::try_to_lock};
+            if (!lk.owns_lock()) {
+                auto start = std::chrono::steady_clock::now();
+                lk.lock();
+                stats_.OnLockWait(std::chrono::steady_clock::now() - start);
+            }
+            return lk;
+        } else {
+            return std::unique_lock{mtx_};
+        }
+    }
+
+    // ---- 调试模式 ----
+    [[noreturn]] static void DebugFail(const char* what, const void* p) noexcept {
+        std::cerr << "ObjectPool: " << what << " at " << p << std::endl;
+        std::abort();
+    }
+
+    // 空闲槽位: 状态字置为 kSlotFree, 除 next 之外的字节填满 kPoison
+    static void Poison(Node* node) noexcept {
+        std::memset(&node->storage, std::to_integer<int>(kPoison), sizeof(T));
+        std::atomic_ref{node->state}.store(kSlotFree, std::memory_order_relaxed);
+    }
+
+    void CheckAllocate(Node* node) const noexcept {
+        if (std::atomic_ref{node->state}.exchange(kSlotLive, std::memory_order_relaxed) !=
+            kSlotFree) {
+            DebugFail("free list corrupted (slot is not free)", node);
+        }
+        // next 占用了前 sizeof(Node*) 个字节, 其余部分应当仍是毒化值
+        for (size_t i = sizeof(Node*); i < sizeof(T); ++i) {
+            if (node->storage[i] != kPoison) {
+                DebugFail("write after free detected", node);
+            }
+        }
+    }
+
+    void CheckDeallocate(Node* node) const noexcept {
+        if (ChunkOf(node)->pool != this) {
+            DebugFail("pointer does not belong to this pool", node);
+        }
+        uint32_t old = std::atomic_ref{node->state}.exchange(kSlotFree, std::memory_order_relaxed);
+        if (old == kSlotFree) {
+            DebugFail("double Deallocate", node);
+        }
+        if (old != kSlotLive) {
+            DebugFail("Deallocate of a pointer that was never allocated", node);
+        }
+    }
+
+    void DeallocateCompact(T* p) noexcept {
+        Deallocate(p);
+        Release();  // NOTE: 必须放在最后, 这可能是池的最后一个引用
+    }
+
+    void Release() noexcept {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    static ChunkHeader* ChunkOf(const void* p) noexcept {
+        return reinterpret_cast<ChunkHeader*>(reinterpret_cast<uintptr_t>(p) &
+                                              ~uintptr_t{kChunkBytes - 1});
+    }
+
+    static Node* NodesOf(ChunkHeader* chunk) noexcept {
+        return reinterpret_cast<Node*>(reinterpret_cast<std::byte*>(chunk) + kHeaderBytes);
+    }
+
+    template <typename F>
+    static void ForEachChunk(const Region& region, F&& f) {
+        auto* base = static_cast<std::byte*>(region.base);
+        for (size_t offset = 0; offset < region.bytes; offset += kChunkBytes) {
+            f(reinterpret_cast<ChunkHeader*>(base + offset));
+        }
+    }
+
+    // 从空闲链表取出一个节点
+    Node* PopNode() {
+        if constexpr (kThreadCached) {
+            if (Magazine* mag = LocalMagazine()) {
+                if (mag->count == 0) {
+                    Refill(mag);  // NOTE: 慢路径, 唯一需要加锁的地方
+                }
+                Node* node = mag->head;
+                mag->head = node->next;
+                --mag->count;
+                return node;
+            }
+            // 弹匣表已析构(线程退出阶段): 直接从全局空闲链表取, 与 Locked 策略相同
+        } else if constexpr (kLockFree) {
+            Node* node = lock_free_head_.Pop();
+            while (node == nullptr) {
+                {
+                    auto lk = Lock();
+                    // NOTE: 等锁期间其他线程可能已经扩容过了
+                    if (lock_free_head_.Empty()) {
+                        Grow();
+                    }
+                }
+                node = lock_free_head_.Pop();
+            }
+            return node;
+        }
+        auto lk = Lock();
+        if constexpr (kThreadCached) {
+            if (free_list_head_ == nullptr) {
+                ReclaimOrphans();
+            }
+        }
+        if (free_list_head_ == nullptr) {
+            Grow();
+        }
+
+        Node* node = free_list_head_;             // 获取头节点
+        free_list_head_ = free_list_head_->next;  // 更新头节点(可能会变成nullptr->扩容)
+        return node;
+    }
+
+    // 将节点归还到空闲链表头部
+    void PushNode(Node* node) noexcept {
+        if constexpr (kThreadCached) {
+            // NOTE: 归还路径只查找不创建弹匣, 保证不分配内存
+            if (Magazine* mag = FindLocalMagazine()) {
+                node->next = mag->head;
+                mag->head = node;
+                if (++mag->count >= Policy::kMagazineSize) {
+                    Flush(mag);  // NOTE: 慢路径, 唯一需要加锁的地方
+                }
+                return;
+            }
+            // 本线程在本池上还没有弹匣(只归还过其他线程分配的对象), 或弹匣表已析构:
+            // 直接还给全局空闲链表, 与 Locked 策略相同
+        } else if constexpr (kLockFree) {
+            lock_free_head_.PushChain(node, node);
+            return;
+        }
+        auto lk = Lock();
+        node->next = free_list_head_;
+        free_list_head_ = node;
+    }
+
+    // 当前线程在本池上已登记的弹匣, 没有登记过或弹匣表已析构时返回 nullptr
+    Magazine* FindLocalMagazine() noexcept {
+        ThreadMagazines* tls = LocalTable();
+        if (tls == nullptr) {
+            return nullptr;
+        }
+        if (tls->cached_id == pool_id_) {
+            return tls->cached;
+        }
+        for (const auto& e : tls->entries) {
+            if (e.pool_id == pool_id_) {
+                tls->cached_id = pool_id_;
+                tls->cached = e.magazine.get();
+                return tls->cached;
+            }
+        }
+        return nullptr;
+    }
+
+    // 当前线程在本池上的弹匣, 第一次分配时创建并登记; 弹匣表已析构时返回 nullptr
+    Magazine* LocalMagazine() {
+        if (Magazine* mag = FindLocalMagazine()) {
+            return mag;
+        }
+        ThreadMagazines* tls = LocalTable();
+        if (tls == nullptr) {
+            return nullptr;
+        }
+
+        // 顺便清理已经销毁的池留下的表项
+        std::erase_if(tls->entries, [](const auto& e) {
+            return e.magazine->pool_dead.load(std::memory_order_acquire);
+        });
+        auto mag = std::make_shared<Magazine>();
+        tls->entries.reserve(tls->entries.size() + 1);  // NOTE: 先保证登记到线程表不会失败
         {
-            std::lock_guard lk{mtx_};
-            // 将归还的节点插回空闲链表头部
-            node->next = free_list_head_;
-            free_list_head_ = node;
+            auto lk = Lock();
+            magazines_.push_back(mag);
         }
+        tls->cached_id = pool_id_;
+        tls->cached = mag.get();
+        tls->entries.push_back({pool_id_, std::move(mag)});
+        return tls->cached;
+    }
+
+    // 弹匣空了: 从全局空闲链表整批取 kBatchSize 个节点
+    void Refill(Magazine* mag) {
+        auto lk = Lock();
+        if (free_list_head_ == nullptr) {
+            ReclaimOrphans();
+        }
+        if (free_list_head_ == nullptr) {
+            Grow();
+        }
+
+        Node* first = free_list_head_;
+        Node* last = first;
+        size_t n = 1;
+        for (; n < Policy::kBatchSize && last->next != nullptr; ++n) {
+            last = last->next;
+        }
+        free_list_head_ = last->next;
+
+        last->next = mag->head;
+        mag->head = first;
+        mag->count += n;
+    }
+
+    // 弹匣满了: 把前 kBatchSize 个节点整批还给全局空闲链表
+    void Flush(Magazine* mag) noexcept {
+        // NOTE: 在锁外找到这一批的尾节点, 锁内只做 O(1) 的拼接
+        Node* first = mag->head;
+        Node* last = first;
+        for (size_t i = 1; i < Policy::kBatchSize; ++i) {
+            last = last->next;
+        }
+        mag->head = last->next;
+        mag->count -= Policy::kBatchSize;
+
+        auto lk = Lock();
+        last->next = free_list_head_;
+        free_list_head_ = first;
+    }
+
+    // 回收已退出线程遗留在弹匣里的节点, 必须由已加锁的调用者保证
+    void ReclaimOrphans() noexcept {
+        std::erase_if(magazines_, [this](const auto& mag) {
+            if (!mag->orphaned.load(std::memory_order_acquire)) {
+                return false;
+            }
+            while (mag->head != nullptr) {
+                Node* node = mag->head;
+                mag->head = node->next;
+                node->next = free_list_head_;
+                free_list_head_ = node;
+            }
+            mag->count = 0;
+            return true;
+        });
     }
 
-private:
     // 扩容, 非线程安全, 必须由已加锁的调用者保证
     void Grow() {
-        // 新增一个内存块
-        pool_chunks_.emplace_back(ChunkSize);
-        auto& new_chunk = pool_chunks_.back();
+        size_t chunks = options_.growth(chunk_count_);
+        if (chunks == 0) {
+            throw std::bad_alloc{};  // 扩容策略已到上限
+        }
+        GrowChunks(chunks);
+    }
+
+    // 新增至少 chunks 个内存块, 必须由已加锁的调用者保证
+    // 通常是一段连续区域; kHeap + separate_heap_chunks 时每个块单独一段区域
+    void GrowChunks(size_t chunks) {
+        const bool separate =
+            options_.backend == ChunkBackend::kHeap && options_.separate_heap_chunks;
+        std::vector<Region> fresh;
+        fresh.reserve(separate ? chunks : 1);
+        try {
+            if (separate) {
+                for (size_t c = 0; c < chunks; ++c) {
+                    fresh.push_back(AllocateRegion(kChunkBytes));
+                }
+            } else {
+                fresh.push_back(AllocateRegion(chunks * kChunkBytes));
+            }
+            if constexpr (kLockFree) {
+                // 地址超出 48 位的区域放不进 TaggedFreeList, 与申请内存失败同样处理
+                for (const Region& region : fresh) {
+                    auto* end = static_cast<std::byte*>(region.base) + region.bytes;
+                    if (!TaggedFreeList::CanHold(end)) {
+                        throw std::bad_alloc{};
+                    }
+                }
+            }
+            regions_.reserve(regions_.size() + fresh.size());
+        } catch (...) {
+            for (const Region& region : fresh) {
+                FreeRegion(region);
+            }
+            throw;
+        }
 
-        // 将新块中的节点串成链表
-        for (size_t i = 0; i < ChunkSize - 1; ++i) {
-            new_chunk[i].next = &new_chunk[i + 1];
+        // 将所有块的节点串成一条链表 (块与块首尾相连)
+        Node* first = nullptr;
+        Node* last = nullptr;
+        chunks = 0;
+        for (const Region& region : fresh) {
+            regions_.push_back(region);
+            // NOTE: 区域可能被向上取整到页大小, 多出来的块也用上
+            ForEachChunk(region, [&](ChunkHeader* chunk) {
+                auto* header = ::new (chunk) ChunkHeader{this, 0};
+                Node* nodes = NodesOf(header);
+                if constexpr (kDebug) {
+                    for (size_t i = 0; i < kNodesPerChunk; ++i) {
+                        Poison(&nodes[i]);
+                    }
+                }
+                for (size_t i = 0; i < kNodesPerChunk - 1; ++i) {
+                    nodes[i].next = &nodes[i + 1];
+                }
+                if (last != nullptr) {
+                    last->next = &nodes[0];
+                } else {
+                    first = &nodes[0];
+                }
+                last = &nodes[kNodesPerChunk - 1];
+                ++chunks;
+            });
         }
-        // NOTE: 最后一个节点连接到旧的空闲链表头
-        new_chunk[ChunkSize - 1].next = free_list_head_;
+        chunk_count_ += chunks;
+        capacity_ += chunks * kNodesPerChunk;
+        stats_.OnGrow();
 
-        // 更新空闲链表头
-        free_list_head_ = &new_chunk[0];
+        if constexpr (kLockFree) {
+            // NOTE: mtx_ 只串行化扩容, 其他线程仍在并发 Pop/Push, 必须用 CAS 发布整条链
+            lock_free_head_.PushChain(first, last);
+        } else {
+            // NOTE: 最后一个节点连接到旧的空闲链表头
+            last->next = free_list_head_;
+
+            // 更新空闲链表头
+            free_list_head_ = first;
+        }
+    }
+
+    Region AllocateRegion(size_t bytes) const {
+        if (options_.backend == ChunkBackend::kHeap) {
+            return {::operator new(bytes, std::align_val_t{kChunkBytes}), bytes,
+                    ChunkBackend::kHeap};
+        }
+
+        // mmap 只保证页对齐: 多映射 align 字节, 再把首尾不对齐的部分 munmap 掉
+        const size_t align = MmapAlign();
+        bytes = (bytes + align - 1) / align * align;
+
+        const size_t map_bytes = bytes + align;
+        void* raw = ::mmap(nullptr, map_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                           -1, 0);
+        if (raw == MAP_FAILED) {
+            throw std::bad_alloc{};
+        }
+        const auto raw_addr = reinterpret_cast<uintptr_t>(raw);
+        const uintptr_t addr = (raw_addr + align - 1) & ~uintptr_t{align - 1};
+        if (addr > raw_addr) {
+            ::munmap(raw, addr - raw_addr);
+        }
+        if (const size_t tail = raw_addr + map_bytes - (addr + bytes); tail > 0) {
+            ::munmap(reinterpret_cast<void*>(addr + bytes), tail);
+        }
+
+        void* base = reinterpret_cast<void*>(addr);
+        if (options_.huge_pages) {
+            // NOTE: 只是建议, 内核不支持透明大页时忽略失败, 退化为普通页
+            ::madvise(base, bytes, MADV_HUGEPAGE);
+        }
+        return {base, bytes, ChunkBackend::kMmap};
+    }
+
+    // kMmap 区域的对齐粒度: 页(或大页)与块大小中较大者
+    // 区域的起点和长度都是它的整数倍, Trim 也以它为单位归还区域中的一部分
+    size_t MmapAlign() const noexcept {
+        const size_t page = options_.huge_pages ? kHugePageSize
+                                                : static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        return std::max(kChunkBytes, page);
+    }
+
+    static void FreeRegion(const Region& region) noexcept {
+        if (region.backend == ChunkBackend::kHeap) {
+            ::operator delete(region.base, region.bytes, std::align_val_t{kChunkBytes});
+        } else {
+            ::munmap(region.base, region.bytes);
+        }
     }
 };
 
@@ -161,6 +1054,82 @@ struct MyObject {
     ~MyObject() { std::cout << "MyObject(" << id << ") destructed at " << this << std::endl; }
 };
 
+// --- 基准测试: 多线程并发分配/归还 ---
+struct Message {
+    uint64_t seq;
+    char payload[56];
+
+    explicit Message(uint64_t s) : seq(s) {}
+};
+
+// 每个线程反复: 连续分配 kBurst 个对象, 再全部归还
+// kCompact: 使用 CompactPtr 句柄, 否则使用带 shared_ptr 的 UniquePtr
+template <typename Pool, bool kCompact = false>
+double BenchAllocFree(size_t thread_count, size_t ops_per_thread) {
+    constexpr size_t kBurst = 16;
+    auto pool = Pool::Create();
+    std::atomic<bool> go{false};
+
+    std::vector<std::jthread> threads;
+    threads.reserve(thread_count);
+    for (size_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&] {
+            using Handle =
+                std::conditional_t<kCompact, typename Pool::CompactPtr, typename Pool::UniquePtr>;
+            std::vector<Handle> held;
+            held.reserve(kBurst);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < ops_per_thread; i += kBurst) {
+                for (size_t j = 0; j < kBurst; ++j) {
+                    if constexpr (kCompact) {
+                        held.push_back(pool->AllocateCompact(i + j));
+                    } else {
+                        held.push_back(pool->Allocate(i + j));
+                    }
+                }
+                held.clear();
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    threads.clear();  // join
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    // 每次操作 = 一次 Allocate + 一次 Deallocate
+    return static_cast<double>(thread_count * ops_per_thread) / elapsed.count() / 1e6;
+}
+
+void RunBenchmarks() {
+    constexpr size_t kOpsPerThread = 200'000;
+    using LockedPool = ObjectPool<Message, 128, pool_policy::Locked>;
+    using CachedPool = ObjectPool<Message, 128, pool_policy::ThreadCached<64>>;
+    using LockFreePool = ObjectPool<Message, 128, pool_policy::LockFree>;
+
+    std::cout << "\n--- Benchmark: alloc/free pairs, Mops/s ---" << std::endl;
+    std::cout << "threads\tLocked\tThreadCached\tLockFree" << std::endl;
+    for (size_t threads = 1; threads <= 64; threads *= 2) {
+        double locked = BenchAllocFree<LockedPool>(threads, kOpsPerThread);
+        double cached = BenchAllocFree<CachedPool>(threads, kOpsPerThread);
+        double lock_free = BenchAllocFree<LockFreePool>(threads, kOpsPerThread);
+        std::cout << threads << "\t" << locked << "\t" << cached << "\t\t" << lock_free
+                  << std::endl;
+    }
+
+    std::cout << "\n--- Benchmark: UniquePtr (" << sizeof(CachedPool::UniquePtr)
+              << " bytes) vs CompactPtr (" << sizeof(CachedPool::CompactPtr)
+              << " bytes), ThreadCached, Mops/s ---" << std::endl;
+    std::cout << "threads\tUniquePtr\tCompactPtr" << std::endl;
+    for (size_t threads = 1; threads <= 64; threads *= 2) {
+        double deleter = BenchAllocFree<CachedPool>(threads, kOpsPerThread);
+        double compact = BenchAllocFree<CachedPool, true>(threads, kOpsPerThread);
+        std::cout << threads << "\t" << deleter << "\t\t" << compact << std::endl;
+    }
+}
+
 int main() {
     // 声明一个 unique_ptr，它将持有来自内部作用域池的对象。
     // 我们明确指定它的类型，以确保它与 temp_pool 的类型一致。
@@ -194,6 +1163,141 @@ int main() {
     p1.reset();  // p1 被销毁。它的Deleter被调用，归还内存。
                  // 这是对池的最后一个 shared_ptr 引用，因此池对象本身现在也被安全销毁。
 
+    std::cout << "\n--- Demonstrating CompactPtr lifetime extension ---" << std::endl;
+    ObjectPool<MyObject, 3>::CompactPtr c1;
+    static_assert(sizeof(c1) == sizeof(MyObject*));
+    {
+        auto temp_pool = ObjectPool<MyObject, 3>::Create();
+        c1 = temp_pool->AllocateCompact(3);
+        // NOTE: 紧凑句柄不增加 shared_ptr 的引用计数
+        std::cout << "After compact allocation, temp_pool use count is still: "
+                  << temp_pool.use_count() << std::endl;
+    }
+    std::cout << "Outside the scope, the pool object is still alive because of c1." << std::endl;
+    c1.reset();  // 最后一个紧凑对象归还, refs_ 归零, 池被析构
+
+    std::cout << "\n--- Growth policy and mmap/huge-page chunks ---" << std::endl;
+    {
+        using MessagePool = ObjectPool<Message>;
+        auto geometric = MessagePool::Create({.growth = pool_growth::Geometric{2.0}});
+        std::vector<MessagePool::CompactPtr> held;
+        for (uint64_t i = 0; i < 10'000; ++i) {
+            held.push_back(geometric->AllocateCompact(i));
+        }
+        std::cout << "Geometric pool capacity after 10000 allocations: " << geometric->Capacity()
+                  << std::endl;
+
+        auto capped = MessagePool::Create(
+            {.growth = pool_growth::Capped<pool_growth::Fixed>{{.chunks = 1}, 2}});
+        try {
+            for (uint64_t i = 0; i <= capped->Capacity(); ++i) {
+                held.push_back(capped->AllocateCompact(i));
+            }
+        } catch (const std::bad_alloc&) {
+            std::cout << "Capped pool refused to grow beyond " << capped->Capacity()
+                      << " objects." << std::endl;
+        }
+
+        auto huge = MessagePool::Create({.backend = ChunkBackend::kMmap, .huge_pages = true});
+        huge->Reserve(1'000'000);
+        std::cout << "mmap + MADV_HUGEPAGE pool reserved capacity: " << huge->Capacity()
+                  << std::endl;
+    }
+
+    std::cout << "\n--- Trim after a burst ---" << std::endl;
+    {
+        auto pool = ObjectPool<Message>::Create();
+        std::vector<ObjectPool<Message>::CompactPtr> burst;
+        for (uint64_t i = 0; i < 10'000; ++i) {
+            burst.push_back(pool->AllocateCompact(i));
+        }
+        // 留下最早分配的一个对象, 它所在的块不能被回收
+        burst.erase(burst.begin() + 1, burst.end());
+        std::cout << "Capacity before Trim: " << pool->Capacity() << std::endl;
+        size_t bytes = pool->Trim();
+        std::cout << "Trim reclaimed " << bytes << " bytes, capacity now: " << pool->Capacity()
+                  << std::endl;
+
+        for (uint64_t i = 0; i < 10'000; ++i) {
+            burst.push_back(pool->AllocateCompact(i));
+        }
+        burst.erase(burst.begin() + 1, burst.end());
+        pool->StartBackgroundTrim(std::chrono::milliseconds{10});
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        std::cout << "Background Trim reclaimed " << pool->ReclaimedBytes() - bytes
+                  << " bytes, capacity now: " << pool->Capacity() << std::endl;
+    }
+
+    std::cout << "\n--- Trim after Reserve with one live object ---" << std::endl;
+    {
+        // Reserve 得到的是一段区域, 唯一存活的对象落在这段区域的第一个块里
+        auto trim_after_reserve = [](const char* name, PoolOptions options) {
+            auto pool = ObjectPool<Message>::Create(std::move(options));
+            pool->Reserve(10'000);
+            auto live = pool->AllocateCompact(uint64_t{0});
+            const size_t before = pool->Capacity();
+            size_t bytes = pool->Trim();
+            std::cout << name << ": capacity " << before << " -> " << pool->Capacity()
+                      << ", reclaimed " << bytes << " bytes" << std::endl;
+        };
+        // 整段区域里只要有一个对象存活就不能归还
+        trim_after_reserve("kHeap", {});
+        trim_after_reserve("kHeap + separate_heap_chunks", {.separate_heap_chunks = true});
+        trim_after_reserve("kMmap", {.backend = ChunkBackend::kMmap});
+    }
+
+    std::cout << "\n--- ThreadCached: returning objects from other threads and at thread exit ---"
+              << std::endl;
+    {
+        using CachedPool = ObjectPool<Message, 128, pool_policy::ThreadCached<64>>;
+        auto pool = CachedPool::Create();
+        const size_t capacity = pool->Capacity();
+
+        // 只归还、从不分配的线程: 没有弹匣, 节点直接回到全局空闲链表
+        std::vector<CachedPool::CompactPtr> handed_over;
+        for (uint64_t i = 0; i < 100; ++i) {
+            handed_over.push_back(pool->AllocateCompact(i));
+        }
+        std::jthread{[&handed_over] { handed_over.clear(); }}.join();
+
+        // late 先于弹匣表构造, 因此在弹匣表析构之后才析构, 归还时弹匣表已经不在了
+        std::jthread{[&pool] {
+            thread_local CachedPool::CompactPtr late;
+            late = pool->AllocateCompact(uint64_t{0});
+        }}.join();
+
+        // 所有节点都应该能重新分配出来, 不需要扩容
+        std::vector<CachedPool::CompactPtr> all;
+        for (uint64_t i = 0; i < capacity; ++i) {
+            all.push_back(pool->AllocateCompact(i));
+        }
+        std::cout << "all " << capacity << " objects reusable without growing: "
+                  << (pool->Capacity() == capacity ? "yes" : "no") << std::endl;
+    }
+
+#if OBJECT_POOL_STATS
+    std::cout << "\n--- Pool statistics (8 threads, Locked) ---" << std::endl;
+    {
+        auto pool = ObjectPool<Message>::Create();
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([&pool] {
+                std::vector<ObjectPool<Message>::CompactPtr> held;
+                for (uint64_t i = 0; i < 1'000; ++i) {
+                    held.push_back(pool->AllocateCompact(i));
+                }
+            });
+        }
+        threads.clear();
+        PoolStats stats = pool->Stats();
+        std::cout << "live: " << stats.live << ", high water: " << stats.high_water
+                  << ", grows: " << stats.grow_count
+                  << ", lock wait: " << stats.lock_wait.count() << " ns" << std::endl;
+    }
+#endif
+
+    RunBenchmarks();
+
     std::cout << "--- End of main ---" << std::endl;
     return 0;
 }
\ No newline at end of file
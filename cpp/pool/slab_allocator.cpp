@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// NOTE: 按大小分级(size class)的 slab 分配器
+// ObjectPool 只服务一种 T; 这里把同样的「侵入式空闲链表 + 按块扩容」推广到多个固定大小:
+// 8/16/32/.../1024 字节各有一个 FixedSizePool, 请求按大小向上取整到所属级别
+// 对外暴露为 std::pmr::memory_resource, std::pmr::vector / map / string 可以直接使用
+
+// NOTE: 与 std::pmr::unsynchronized_pool_resource 一样不加锁, 多线程时每个线程各用一个
+
+// 单一大小的内存池: 空闲时块的前 8 字节是指向下一个空闲块的指针
+class FixedSizePool {
+public:
+    FixedSizePool(size_t block_size, size_t chunk_bytes, std::pmr::memory_resource* upstream)
+        : block_size_(block_size), chunk_bytes_(chunk_bytes), upstream_(upstream) {}
+
+    ~FixedSizePool() { Release(); }
+
+    // 禁止拷贝和移动
+    FixedSizePool(const FixedSizePool&) = delete;
+    FixedSizePool& operator=(const FixedSizePool&) = delete;
+
+    void* Allocate() {
+        if (free_list_head_ == nullptr) {
+            Grow();
+        }
+        FreeNode* node = free_list_head_;
+        free_list_head_ = node->next;
+        return node;
+    }
+
+    void Deallocate(void* p) noexcept {
+        auto* node = static_cast<FreeNode*>(p);
+        node->next = free_list_head_;
+        free_list_head_ = node;
+    }
+
+    // 把所有内存块还给上游, 已分配出去的块全部失效
+    void Release() noexcept {
+        for (void* chunk : chunks_) {
+            upstream_->deallocate(chunk, chunk_bytes_, ChunkAlignment());
+        }
+        chunks_.clear();
+        free_list_head_ = nullptr;
+    }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    // NOTE: 块大小是 2 的幂, 内存块按块大小对齐后, 每个块天然满足 alignof <= block_size_ 的请求
+    size_t ChunkAlignment() const noexcept { return block_size_; }
+
+    void Grow() {
+        // 先登记再分配, 保证 push_back 抛异常时不会泄漏内存块
+        chunks_.reserve(chunks_.size() + 1);
+        auto* chunk = static_cast<std::byte*>(upstream_->allocate(chunk_bytes_, ChunkAlignment()));
+        chunks_.push_back(chunk);
+
+        // 将新块中的节点从后往前串成链表, 最后一个节点连接到旧的空闲链表头
+        const size_t count = chunk_bytes_ / block_size_;
+        FreeNode* next = free_list_head_;
+        for (size_t i = count; i-- > 0;) {
+            auto* node = reinterpret_cast<FreeNode*>(chunk + i * block_size_);
+            node->next = next;
+            next = node;
+        }
+        free_list_head_ = next;
+    }
+
+    const size_t block_size_;
+    const size_t chunk_bytes_;
+    std::pmr::memory_resource* const upstream_;
+    FreeNode* free_list_head_{nullptr};
+    std::vector<void*> chunks_;
+};
+
+// 8 ~ 1024 字节共 8 个级别, 更大的请求或更严格的对齐直接交给上游
+class SlabResource : public std::pmr::memory_resource {
+public:
+    static constexpr size_t kMinBlock = 8;
+    static constexpr size_t kMaxBlock = 1024;
+    static constexpr size_t kClassCount = std::countr_zero(kMaxBlock / kMinBlock) + 1;
+
+    explicit SlabResource(size_t chunk_bytes = 64 * 1024,
+                          std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : upstream_(upstream), pools_(MakePools(chunk_bytes, upstream)) {}
+
+    // 禁止拷贝和移动
+    SlabResource(const SlabResource&) = delete;
+    SlabResource& operator=(const SlabResource&) = delete;
+
+    std::pmr::memory_resource* upstream_resource() const noexcept { return upstream_; }
+
+    // 释放所有级别持有的内存块
+    void Release() noexcept {
+        for (auto& pool : pools_) {
+            pool.Release();
+        }
+    }
+
+private:
+    static constexpr size_t ClassIndex(size_t bytes) noexcept {
+        // 向上取整到 2 的幂: 1~8 -> 0, 9~16 -> 1, ..., 513~1024 -> 7
+        return std::bit_width(std::max(bytes, kMinBlock) - 1) - std::bit_width(kMinBlock - 1);
+    }
+
+    static constexpr bool UsesSlab(size_t bytes, size_t alignment) noexcept {
+        return bytes <= kMaxBlock && alignment <= std::bit_ceil(std::max(bytes, kMinBlock));
+    }
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (!UsesSlab(bytes, alignment)) {
+            return upstream_->allocate(bytes, alignment);
+        }
+        return pools_[ClassIndex(bytes)].Allocate();
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        if (!UsesSlab(bytes, alignment)) {
+            upstream_->deallocate(p, bytes, alignment);
+            return;
+        }
+        pools_[ClassIndex(bytes)].Deallocate(p);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    template <size_t... I>
+    static std::array<FixedSizePool, kClassCount> MakePoolsImpl(size_t chunk_bytes,
+                                                                std::pmr::memory_resource* upstream,
+                                                                std::index_sequence<I...>) {
+        return {FixedSizePool{kMinBlock << I, std::max(chunk_bytes, kMinBlock << I), upstream}...};
+    }
+
+    static std::array<FixedSizePool, kClassCount> MakePools(size_t chunk_bytes,
+                                                            std::pmr::memory_resource* upstream) {
+        return MakePoolsImpl(chunk_bytes, upstream, std::make_index_sequence<kClassCount>{});
+    }
+
+    std::pmr::memory_resource* upstream_;
+    std::array<FixedSizePool, kClassCount> pools_;
+};
+
+// --- 基准测试 ---
+
+// 直接调用 malloc/free 的 memory_resource, 作为 glibc 的基线
+class MallocResource : public std::pmr::memory_resource {
+    void* do_allocate(size_t bytes, size_t /*alignment*/) override {
+        void* p = std::malloc(bytes);
+        if (p == nullptr) {
+            throw std::bad_alloc{};
+        }
+        return p;
+    }
+
+    void do_deallocate(void* p, size_t /*bytes*/, size_t /*alignment*/) override { std::free(p); }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+// 随机大小(8~1024)的分配/释放, 维持一个固定大小的存活窗口
+double BenchRandomSizes(std::pmr::memory_resource* mr, size_t ops) {
+    constexpr size_t kWindow = 4096;
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<size_t> size_dist{8, 1024};
+
+    std::vector<std::pair<void*, size_t>> live(kWindow, {nullptr, 0});
+    std::vector<size_t> sizes(ops);
+    for (auto& s : sizes) {
+        s = size_dist(rng);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        auto& slot = live[i % kWindow];
+        if (slot.first != nullptr) {
+            mr->deallocate(slot.first, slot.second);
+        }
+        slot = {mr->allocate(sizes[i]), sizes[i]};
+    }
+    for (auto& [p, n] : live) {
+        if (p != nullptr) {
+            mr->deallocate(p, n);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(ops) / elapsed.count() / 1e6;
+}
+
+// 反复构建/销毁一个 std::pmr::map<int, std::pmr::string>
+double BenchPmrMap(std::pmr::memory_resource* mr, size_t rounds) {
+    constexpr int kEntries = 10'000;
+    size_t ops = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; ++r) {
+        std::pmr::map<int, std::pmr::string> m{mr};
+        for (int i = 0; i < kEntries; ++i) {
+            m.try_emplace(i, "a value long enough to defeat SSO");
+        }
+        ops += kEntries;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(ops) / elapsed.count() / 1e6;
+}
+
+int main() {
+    std::cout << "--- std::pmr containers on SlabResource ---" << std::endl;
+    {
+        SlabResource slab;
+        std::pmr::vector<std::pmr::string> names{&slab};
+        for (int i = 0; i < 5; ++i) {
+            names.emplace_back("slab-allocated string number " + std::to_string(i));
+        }
+        for (const auto& name : names) {
+            std::cout << name << " @ " << static_cast<const void*>(name.data()) << std::endl;
+        }
+    }
+
+    MallocResource malloc_resource;
+    std::pmr::unsynchronized_pool_resource pool_resource;
+    SlabResource slab_resource;
+
+    std::cout << "\n--- Benchmark: random sizes 8~1024, Mops/s ---" << std::endl;
+    constexpr size_t kOps = 2'000'000;
+    std::cout << "malloc\t\t\t" << BenchRandomSizes(&malloc_resource, kOps) << std::endl;
+    std::cout << "unsynchronized_pool\t" << BenchRandomSizes(&pool_resource, kOps) << std::endl;
+    std::cout << "SlabResource\t\t" << BenchRandomSizes(&slab_resource, kOps) << std::endl;
+
+    std::cout << "\n--- Benchmark: pmr::map<int, pmr::string> inserts, Mops/s ---" << std::endl;
+    constexpr size_t kRounds = 20;
+    std::cout << "malloc\t\t\t" << BenchPmrMap(&malloc_resource, kRounds) << std::endl;
+    std::cout << "unsynchronized_pool\t" << BenchPmrMap(&pool_resource, kRounds) << std::endl;
+    std::cout << "SlabResource\t\t" << BenchPmrMap(&slab_resource, kRounds) << std::endl;
+
+    return 0;
+}
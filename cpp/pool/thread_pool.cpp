@@ -1,122 +1,2581 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <concepts>
 #include <condition_variable>
+#include <coroutine>
 #include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
 #include <functional>
 #include <future>
+#include <iostream>
+#include <memory>
 #include <mutex>
 #include <queue>
+#include <ranges>
+#include <semaphore>
+#include <span>
+#include <sstream>
 #include <stdexcept>
+#include <string>
 #include <thread>
 #include <type_traits>
 #include <utility>
+#include <variant>
 #include <vector>
 
-// C++17/20 实现的一个简单、可靠的固定大小线程池
+#include <pthread.h>
+#include <sched.h>
+
+// Chase-Lev 工作窃取双端队列 (Lê et al. 2013, C11 内存模型版本)
+// 所有者线程在底部(bottom) Push/Pop (LIFO, 缓存友好), 其他线程从顶部(top) Steal (FIFO)
+// 只有当队列里只剩最后一个元素时, 所有者和窃取者才需要用 CAS 争抢
+// NOTE: T 必须是可平凡拷贝的(这里存任务指针), 窃取者读槽位时可能与所有者扩容并发
+template <typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque stores trivially copyable T");
+
+public:
+    explicit WorkStealingDeque(int64_t capacity = 256)
+        : buffer_(new Buffer{capacity}) {
+        retired_.emplace_back(buffer_.load(std::memory_order_relaxed));
+    }
+
+    // 禁止拷贝和移动
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // 仅所有者调用
+    void Push(T item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Buffer* buf = buffer_.load(std::memory_order_relaxed);
+        if (b - t > buf->capacity - 1) {
+            buf = Grow(buf, t, b);
+        }
+        buf->Put(b, item);
+        bottom_.store(b + 1, std::memory_order_release);  // 发布槽位, 与 Steal 的 acquire 配对
+    }
+
+    // 仅所有者调用: 保证接下来的 n 次 Push 不需要扩容, 因而不会抛异常
+    // NOTE: 读到的 top 可能偏旧, 估出的元素数只会偏大, 预留得只多不少
+    void Reserve(int64_t n) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Buffer* buf = buffer_.load(std::memory_order_relaxed);
+        if (b - t + n > buf->capacity) {
+            Grow(buf, t, b, static_cast<int64_t>(std::bit_ceil(static_cast<uint64_t>(b - t + n))));
+        }
+    }
+
+    // 仅所有者调用, 从底部取
+    bool Pop(T& out) {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Buffer* buf = buffer_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        // NOTE: 先「预占」底部元素再读 top, 与 Steal 中的 fence 配对
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {  // 队列为空, 恢复 bottom
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        out = buf->Get(b);
+        if (t == b) {
+            // 最后一个元素: 与窃取者用 CAS 争抢
+            bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // 任意线程调用, 从顶部偷
+    bool Steal(T& out) {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+        Buffer* buf = buffer_.load(std::memory_order_acquire);
+        T item = buf->Get(t);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return false;  // 被所有者或其他窃取者抢先
+        }
+        out = item;
+        return true;
+    }
+
+    // 近似大小, 仅供参考
+    int64_t Size() const noexcept {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+
+private:
+    struct Buffer {
+        int64_t capacity;  // 2 的幂
+        std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit Buffer(int64_t cap) : capacity(cap), slots(new std::atomic<T>[cap]) {}
+
+        void Put(int64_t i, T item) noexcept {
+            slots[i & (capacity - 1)].store(item, std::memory_order_relaxed);
+        }
+        T Get(int64_t i) const noexcept {
+            return slots[i & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+    };
+
+    // 扩容(默认翻倍); 旧缓冲区可能仍被窃取者读取, 留到队列析构时再释放
+    Buffer* Grow(Buffer* old, int64_t t, int64_t b, int64_t capacity = 0) {
+        auto owned = std::make_unique<Buffer>(capacity > 0 ? capacity : old->capacity * 2);
+        Buffer* bigger = owned.get();
+        for (int64_t i = t; i < b; ++i) {
+            bigger->Put(i, old->Get(i));
+        }
+        retired_.push_back(std::move(owned));  // NOTE: 抛异常时队列保持原样, 新缓冲区随 owned 释放
+        buffer_.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<Buffer*> buffer_;
+    std::vector<std::unique_ptr<Buffer>> retired_;  // 仅所有者修改
+};
+
+// 只能移动的类型擦除可调用对象 void()
+// 与 std::function 相比: 不要求可拷贝(可以直接装 packaged_task), 且不超过 kInlineSize 的
+// 可调用对象直接存放在内部缓冲区(SBO), 不分配堆内存
+// NOTE: 整个 Job 恰好 64 字节, 一个任务节点占一条缓存行; 其中 8 字节记录入队时间, 供统计排队延迟
+class Job {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t kInlineSize = 48;
+
+    Job() noexcept = default;
+
+    template <class F>
+        requires(!std::is_same_v<std::decay_t<F>, Job> && std::is_invocable_v<std::decay_t<F>&>)
+    Job(F&& f) {  // NOLINT: 允许隐式转换, 与 std::function 一致
+        using Fn = std::decay_t<F>;
+        if constexpr (kFitsInline<Fn>) {
+            ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(f));
+        } else {
+            ::new (static_cast<void*>(storage_)) Fn*(new Fn(std::forward<F>(f)));
+        }
+        vtable_ = &kVTable<Fn>;
+    }
+
+    Job(Job&& other) noexcept
+        : vtable_(std::exchange(other.vtable_, nullptr)), enqueued_(other.enqueued_) {
+        if (vtable_ != nullptr) {
+            vtable_->move(storage_, other.storage_);
+        }
+    }
+
+    Job& operator=(Job&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            vtable_ = std::exchange(other.vtable_, nullptr);
+            enqueued_ = other.enqueued_;
+            if (vtable_ != nullptr) {
+                vtable_->move(storage_, other.storage_);
+            }
+        }
+        return *this;
+    }
+
+    ~Job() { Reset(); }
+
+    explicit operator bool() const noexcept { return vtable_ != nullptr; }
+
+    void operator()() { vtable_->invoke(storage_); }
+
+    // 入队时间: 只在线程池开启计时时记录, 否则保持默认值
+    void SetEnqueueTime(Clock::time_point t) noexcept { enqueued_ = t; }
+    Clock::time_point EnqueueTime() const noexcept { return enqueued_; }
+
+private:
+    struct VTable {
+        void (*invoke)(void* self);
+        void (*move)(void* dst, void* src) noexcept;  // 移动到 dst 并销毁 src
+        void (*destroy)(void* self) noexcept;
+    };
+
+    // NOTE: 移动构造可能抛异常的类型放到堆上, 保证 Job 的移动是 noexcept
+    template <class Fn>
+    static constexpr bool kFitsInline = sizeof(Fn) <= kInlineSize &&
+                                        alignof(Fn) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible_v<Fn>;
+
+    template <class Fn>
+    static constexpr VTable MakeVTable() {
+        if constexpr (kFitsInline<Fn>) {
+            return {
+                [](void* self) { (*static_cast<Fn*>(self))(); },
+                [](void* dst, void* src) noexcept {
+                    ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+                    static_cast<Fn*>(src)->~Fn();
+                },
+                [](void* self) noexcept { static_cast<Fn*>(self)->~Fn(); },
+            };
+        } else {
+            // 缓冲区里只存一个指向堆对象的指针
+            return {
+                [](void* self) { (**static_cast<Fn**>(self))(); },
+                [](void* dst, void* src) noexcept {
+                    ::new (dst) Fn*(*static_cast<Fn**>(src));
+                },
+                [](void* self) noexcept { delete *static_cast<Fn**>(self); },
+            };
+        }
+    }
+
+    template <class Fn>
+    static constexpr VTable kVTable = MakeVTable<Fn>();
+
+    void Reset() noexcept {
+        if (vtable_ != nullptr) {
+            vtable_->destroy(storage_);
+            vtable_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) std::byte storage_[kInlineSize];
+    const VTable* vtable_{nullptr};
+    Clock::time_point enqueued_{};
+};
+
+static_assert(sizeof(Job) == 64);
+
+// 任务节点(一个 Job 大小的内存块)的回收缓存
+// 每个线程一个小缓存, 空了从全局仓库整批取, 满了把一半整批还回去 (思路同 ObjectPool 的
+// ThreadCached 策略): 外部线程提交、工作线程释放的生产者/消费者模式下, 稳态时不再调用 new
+// NOTE: 静态存储期的 ThreadPool 在 main 之后才析构, 那时各线程的缓存、甚至仓库本身都可能已经析构:
+// 仓库故意泄漏(永不析构); 线程缓存析构之后的申请/释放直接走 operator new/delete
+class JobNodeCache {
+public:
+    static void* Acquire() {
+        if (LocalDestroyed()) {
+            return ::operator new(sizeof(Job), std::align_val_t{alignof(Job)});
+        }
+        auto& local = Local();
+        if (local.nodes.empty()) {
+            Instance().Refill(local.nodes);
+        }
+        void* p = local.nodes.back();
+        local.nodes.pop_back();
+        return p;
+    }
+
+    static void Release(void* p) noexcept {
+        if (LocalDestroyed()) {
+            ::operator delete(p, std::align_val_t{alignof(Job)});
+            return;
+        }
+        auto& local = Local();
+        if (local.nodes.size() >= 2 * kBatchSize) {
+            Instance().Flush(local.nodes, kBatchSize);
+        }
+        local.nodes.push_back(p);  // NOTE: capacity 已预留 2 * kBatchSize, 不会分配
+    }
+
+private:
+    static constexpr std::size_t kBatchSize = 64;
+
+    struct LocalCache {
+        LocalCache() { nodes.reserve(2 * kBatchSize); }
+        ~LocalCache() {
+            Instance().Flush(nodes, nodes.size());  // 线程退出时全部还给仓库
+            LocalDestroyed() = true;
+        }
+        std::vector<void*> nodes;
+    };
+
+    // 进程退出时仓库里的节点交给操作系统回收
+    static JobNodeCache& Instance() {
+        static auto* instance = new JobNodeCache;
+        return *instance;
+    }
+
+    // 平凡类型没有析构函数, 线程退出的任何阶段都可以读 (同 ObjectPool::TlsDestroyed)
+    static bool& LocalDestroyed() noexcept {
+        thread_local bool destroyed = false;
+        return destroyed;
+    }
+
+    static LocalCache& Local() {
+        static thread_local LocalCache cache;
+        return cache;
+    }
+
+    void Refill(std::vector<void*>& out) {
+        {
+            std::lock_guard lk{mtx_};
+            std::size_t n = std::min(kBatchSize, depot_.size());
+            out.insert(out.end(), depot_.end() - static_cast<std::ptrdiff_t>(n), depot_.end());
+            depot_.resize(depot_.size() - n);
+        }
+        while (out.size() < kBatchSize) {
+            out.push_back(::operator new(sizeof(Job), std::align_val_t{alignof(Job)}));
+        }
+    }
+
+    void Flush(std::vector<void*>& from, std::size_t n) noexcept {
+        std::lock_guard lk{mtx_};
+        // HACK: 仓库扩容失败时直接释放, 不让 noexcept 的 Release 抛异常
+        try {
+            depot_.insert(depot_.end(), from.end() - static_cast<std::ptrdiff_t>(n), from.end());
+        } catch (...) {
+            for (auto it = from.end() - static_cast<std::ptrdiff_t>(n); it != from.end(); ++it) {
+                ::operator delete(*it, std::align_val_t{alignof(Job)});
+            }
+        }
+        from.resize(from.size() - n);
+    }
+
+    std::mutex mtx_;
+    std::vector<void*> depot_;
+};
+
+// --- 协程 ---
+
+// 惰性启动的协程任务: 创建后不执行, 直到被 co_await
+// co_await 一个 Task 时用对称转移(symmetric transfer)直接切到它的协程帧; 它结束时再切回等待者,
+// 整条 co_await 链既不阻塞线程也不会因为层层 resume() 而耗尽栈
+template <typename T = void>
+class [[nodiscard]] Task;
+
+namespace task_detail {
+
+// 结束时恢复等待者, 没有等待者则回到 resume() 的调用方
+struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+
+    template <class Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+        if (auto cont = h.promise().continuation) {
+            return cont;
+        }
+        return std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+struct PromiseBase {
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    Task<T> get_return_object() noexcept;
+
+    template <class U>
+    void return_value(U&& v) {
+        value.emplace(std::forward<U>(v));
+    }
+
+    T Result() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(*value);
+    }
+
+    std::optional<T> value;
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void Result() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+// 立即开始、结束后自动销毁的协程, 仅供 SyncWait / WhenAll 内部启动子任务用
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+}  // namespace task_detail
+
+template <typename T>
+class [[nodiscard]] Task {
+    static_assert(!std::is_reference_v<T>, "Task<T&> is not supported");
+
+public:
+    using promise_type = task_detail::Promise<T>;
+
+    Task() noexcept = default;
+    explicit Task(std::coroutine_handle<promise_type> h) noexcept : handle_(h) {}
+
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    // 禁止拷贝: 协程帧只能有一个所有者
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    auto operator co_await() const noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> h;
+
+            // NOTE: 空 Task(默认构造或已被移走)没有协程帧可等, 也没有结果可取, 直接报错
+            // 异常从 co_await 表达式抛出, 由等待方协程照常捕获或记录
+            bool await_ready() const {
+                if (!h) {
+                    throw std::logic_error("co_await on an empty Task");
+                }
+                return h.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                h.promise().continuation = awaiting;
+                return h;  // 对称转移: 直接开始执行被等待的任务
+            }
+
+            T await_resume() { return h.promise().Result(); }
+        };
+        return Awaiter{handle_};
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+template <typename T>
+Task<T> task_detail::Promise<T>::get_return_object() noexcept {
+    return Task<T>{std::coroutine_handle<Promise>::from_promise(*this)};
+}
+
+inline Task<void> task_detail::Promise<void>::get_return_object() noexcept {
+    return Task<void>{std::coroutine_handle<Promise>::from_promise(*this)};
+}
+
+// 在普通函数里阻塞等待一个 Task 完成并取得结果 (只应在线程池之外调用, 例如 main)
+template <typename T>
+T SyncWait(Task<T> task) {
+    auto done = std::make_shared<std::promise<void>>();
+    std::future<void> finished = done->get_future();
+    std::exception_ptr error;
+    std::optional<std::conditional_t<std::is_void_v<T>, std::monostate, T>> result;
+    // NOTE: signal 按值作为参数拷贝进协程帧: 等待方醒来返回后, set_value 仍在访问的 promise
+    // 由协程帧持有, 不会落在已销毁的栈上
+    auto run = [&](std::shared_ptr<std::promise<void>> signal) -> task_detail::Detached {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await task;
+                result.emplace();
+            } else {
+                result.emplace(co_await task);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        signal->set_value();
+    };
+    run(done);
+    finished.wait();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*result);
+    }
+}
+
+// 并发等待一组 Task: 依次启动它们, 最后一个完成的子任务恢复等待者
+// 子任务要真正并行, 需要在内部 co_await pool.Schedule(); 第一个异常在全部完成后重新抛出
+template <typename T>
+auto WhenAll(std::vector<Task<T>> tasks)
+    -> Task<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> {
+    using Slot = std::optional<std::conditional_t<std::is_void_v<T>, std::monostate, T>>;
+    std::vector<Slot> results(tasks.size());
+    std::vector<std::exception_ptr> errors(tasks.size());
+
+    struct Awaiter {
+        std::vector<Task<T>>& tasks;
+        std::vector<Slot>& results;
+        std::vector<std::exception_ptr>& errors;
+        std::atomic<std::size_t> remaining{0};
+        std::coroutine_handle<> parent;
+
+        static task_detail::Detached RunChild(Awaiter* self, std::size_t i) {
+            try {
+                if constexpr (std::is_void_v<T>) {
+                    co_await self->tasks[i];
+                    self->results[i].emplace();
+                } else {
+                    self->results[i].emplace(co_await self->tasks[i]);
+                }
+            } catch (...) {
+                self->errors[i] = std::current_exception();
+            }
+            if (self->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                self->parent.resume();
+            }
+        }
+
+        bool await_ready() const noexcept { return tasks.empty(); }
+
+        bool await_suspend(std::coroutine_handle<> h) {
+            parent = h;
+            // NOTE: 多计 1, 防止子任务在这里还没返回时就全部完成并恢复父协程
+            remaining.store(tasks.size() + 1, std::memory_order_relaxed);
+            for (std::size_t i = 0; i < tasks.size(); ++i) {
+                RunChild(this, i);
+            }
+            return remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;  // false: 立即继续
+        }
+
+        void await_resume() const noexcept {}
+    };
+    co_await Awaiter{tasks, results, errors, {}, {}};
+
+    for (auto& e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+    if constexpr (!std::is_void_v<T>) {
+        std::vector<T> values;
+        values.reserve(results.size());
+        for (auto& r : results) {
+            values.push_back(std::move(*r));
+        }
+        co_return values;
+    }
+}
+
+// 本机的 NUMA 拓扑: 每个节点上本进程可用的 CPU 列表
+// NOTE: 读 /sys/devices/system/node/node*/cpulist, 再用 sched_getaffinity 过滤掉不允许的 CPU;
+// 读不到(容器、非 NUMA 内核)时把所有可用 CPU 当成一个节点
+class CpuTopology {
+public:
+    // 进程内只探测一次
+    static const CpuTopology& Get() {
+        static const CpuTopology topology;
+        return topology;
+    }
+
+    std::size_t NodeCount() const noexcept { return nodes_.size(); }
+    std::size_t CpuCount() const noexcept { return cpus_.size(); }
+    const std::vector<int>& NodeCpus(std::size_t node) const { return nodes_[node]; }
+    // 按节点排列的全部 CPU: 第 i 个工作线程绑第 i 个, 相邻编号落在同一节点
+    const std::vector<int>& Cpus() const noexcept { return cpus_; }
+
+    std::size_t NodeOf(int cpu) const noexcept {
+        return cpu >= 0 && static_cast<std::size_t>(cpu) < node_of_.size() ? node_of_[cpu] : 0;
+    }
+
+    // 调用线程此刻所在的节点
+    std::size_t CurrentNode() const noexcept { return NodeOf(::sched_getcpu()); }
+
+    // 解析 "0-3,8-11" 这样的 CPU 列表
+    static std::vector<int> ParseCpuList(const std::string& text) {
+        std::vector<int> cpus;
+        std::istringstream in{text};
+        std::string range;
+        while (std::getline(in, range, ',')) {
+            int lo = 0;
+            int hi = 0;
+            char dash = 0;
+            std::istringstream r{range};
+            if (!(r >> lo)) {
+                continue;
+            }
+            hi = (r >> dash >> hi) && dash == '-' ? hi : lo;
+            for (int cpu = lo; cpu <= hi; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+private:
+    CpuTopology() {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                CPU_SET(cpu, &allowed);
+            }
+        }
+        // NOTE: 节点编号可能不连续 (比如只有 node0 和 node2), 按出现顺序重新编号
+        for (int id = 0; id < 1024; ++id) {
+            std::ifstream file{"/sys/devices/system/node/node" + std::to_string(id) + "/cpulist"};
+            std::string line;
+            if (!file || !std::getline(file, line)) {
+                continue;
+            }
+            std::vector<int> cpus;
+            for (int cpu : ParseCpuList(line)) {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                    cpus.push_back(cpu);
+                }
+            }
+            if (!cpus.empty()) {
+                nodes_.push_back(std::move(cpus));
+            }
+        }
+        if (nodes_.empty()) {
+            nodes_.emplace_back();
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed)) {
+                    nodes_.back().push_back(cpu);
+                }
+            }
+        }
+        for (std::size_t node = 0; node < nodes_.size(); ++node) {
+            for (int cpu : nodes_[node]) {
+                if (static_cast<std::size_t>(cpu) >= node_of_.size()) {
+                    node_of_.resize(cpu + 1, 0);
+                }
+                node_of_[cpu] = node;
+                cpus_.push_back(cpu);
+            }
+        }
+    }
+
+    std::vector<std::vector<int>> nodes_;  // 节点 -> CPU 列表
+    std::vector<std::size_t> node_of_;     // CPU -> 节点
+    std::vector<int> cpus_;
+};
+
+// 工作线程的绑核方式
+enum class CpuAffinity : uint8_t {
+    kNone,      // 不绑定, 交给调度器
+    kCore,      // 每个工作线程绑一个 CPU, 按节点依次铺开
+    kNumaNode,  // 工作线程轮流分到各节点, 可以在本节点的所有 CPU 上迁移
+};
+
+// 按 2 的幂分桶的延迟直方图: 第 i 个桶统计 [2^(i-1), 2^i) 纳秒, 第 0 个桶只有 0ns
+// NOTE: 分桶粗(相对误差 < 2 倍)但定长、无锁, 线程池里每个工作线程各记一份, 读取时再合并
+struct LatencyHistogram {
+    static constexpr std::size_t kBuckets = 48;  // 最大桶上界 2^47ns, 约 39 小时
+
+    std::array<uint64_t, kBuckets> counts{};
+
+    static std::size_t BucketOf(std::chrono::nanoseconds d) noexcept {
+        const auto ns = static_cast<uint64_t>(std::max<int64_t>(d.count(), 0));
+        return std::min<std::size_t>(std::bit_width(ns), kBuckets - 1);
+    }
+
+    uint64_t Count() const noexcept {
+        uint64_t n = 0;
+        for (uint64_t c : counts) {
+            n += c;
+        }
+        return n;
+    }
+
+    // 第 q (0~1) 分位所在桶的上界; 没有样本时返回 0
+    std::chrono::nanoseconds Percentile(double q) const noexcept {
+        const uint64_t total = Count();
+        if (total == 0) {
+            return std::chrono::nanoseconds{0};
+        }
+        const auto rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        std::size_t i = 0;
+        while (i + 1 < kBuckets && (seen += counts[i]) < rank) {
+            ++i;
+        }
+        return std::chrono::nanoseconds{i == 0 ? 0 : int64_t{1} << i};
+    }
+
+    LatencyHistogram& operator+=(const LatencyHistogram& other) noexcept {
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            counts[i] += other.counts[i];
+        }
+        return *this;
+    }
+};
+
+// 任务开始/结束钩子收到的事件
+struct TaskEvent {
+    std::size_t worker{0};                           // 执行任务的工作线程槽位
+    std::chrono::steady_clock::time_point enqueued;  // 入队时间
+    std::chrono::steady_clock::time_point begin;     // 开始执行时间
+    std::chrono::steady_clock::time_point end;       // 执行结束时间 (只在结束钩子里有效)
+};
+
+// NOTE: 钩子在工作线程上同步调用, 必须线程安全、不抛异常, 而且要快: 它的耗时算在任务头上
+using TaskHook = std::function<void(const TaskEvent&)>;
+
+// ThreadPool 的可调参数
+struct ThreadPoolOptions {
+    // 工作线程没找到任务时, 先自旋(pause 然后 yield)等待这么久再睡眠; 0 表示立即睡眠
+    // NOTE: 实际自旋时长在 [spin_min, spin_max] 内自适应: 上次自旋等到了任务就加倍, 否则减半
+    std::chrono::microseconds spin_max{50};
+    std::chrono::microseconds spin_min{1};
+    // 弹性线程数: 构造时的 thread_count 是下限, 所有线程都忙且积压的任务比线程多时
+    // 逐个加线程直到 max_threads; 多出来的线程空闲 idle_timeout 后退出。0 表示固定线程数
+    std::size_t max_threads{0};
+    std::chrono::milliseconds idle_timeout{1000};
+    // 绑核之后, 提交方优先唤醒同节点的空闲线程, 空闲线程优先窃取同节点的队列
+    CpuAffinity affinity{CpuAffinity::kNone};
+    // 记录每个任务的排队时间和执行时间 (每个任务多读 3 次时钟); 设置了任一钩子时自动打开
+    // NOTE: 任务数、窃取数、睡眠次数等计数器总是开着, 它们只写工作线程自己的缓存行
+    bool collect_timing{false};
+    TaskHook on_task_begin{};
+    TaskHook on_task_end{};
+};
+
+// C++17/20 实现的一个工作窃取线程池
 // 特性：
 //   * Submit 任意可调用对象，返回 std::future<R>
+//   * Post 提交不需要结果的任务: 不创建 future, 小任务全程不分配堆内存
+//   * SubmitBatch 批量提交, ParallelFor / ParallelReduce 按引导式分块并行执行循环
+//   * co_await pool.Schedule() 把协程切换到工作线程上继续执行, 配合 Task<T> 使用
+//   * 每个工作线程有自己的 Chase-Lev 双端队列, 工作线程内部提交的任务直接进本地队列
+//   * 外部线程提交的任务进全局注入队列(mtx_ 保护), 空闲的工作线程随机挑选受害者窃取
+//   * 注入队列分高/中/低三条优先级车道, 车道内按截止时间(EDF)排序, 低车道有饥饿保护
+//   * 空闲的工作线程先自适应自旋, 再在各自的停车位上睡眠, 提交任务时只定向唤醒一个
+//   * 线程数可在 [thread_count, max_threads] 之间伸缩; 可按核或 NUMA 节点绑定工作线程
+//   * GetMetrics() 无锁读取每个工作线程的计数器和排队延迟直方图; 任务开始/结束钩子可接
+//     ChromeTraceWriter 导出时间线
 //   * 析构或 Shutdown() 会阻止新任务并等待工作线程退出
 //   * 异常在 future.get() 时重新抛出
 class ThreadPool {
 public:
-    explicit ThreadPool(std::size_t thread_count) : stopping_(false) {
+    using Clock = std::chrono::steady_clock;
+
+    // 优先级车道: 数值越小越优先
+    enum class Priority : uint8_t { kHigh, kNormal, kLow };
+    static constexpr std::size_t kLaneCount = 3;
+
+    // 单条车道的计数 (只统计进入车道的任务, 工作线程本地队列里的任务不在其中)
+    struct LaneStats {
+        std::size_t depth{0};                 // 当前排队数
+        uint64_t dispatched{0};               // 已出队数
+        std::chrono::nanoseconds total_wait{0};  // 累计排队时间
+        std::chrono::nanoseconds max_wait{0};    // 最长排队时间
+        uint64_t deadline_misses{0};          // 出队时已过了显式截止时间的任务数
+    };
+
+    // 单个工作线程槽位的计数 (槽位上先后运行过的线程累计在一起)
+    struct WorkerStats {
+        bool running{false};             // 槽位上当前有没有线程
+        std::size_t deque_depth{0};      // 本地队列当前长度
+        uint64_t tasks{0};               // 执行过的任务数 (下面三项之和)
+        uint64_t local{0};               // 其中从本地队列取到的
+        uint64_t stolen{0};              // 其中从别的工作线程窃取的
+        uint64_t from_lanes{0};          // 其中从注入队列(车道)取到的
+        uint64_t parks{0};               // 睡眠次数
+        std::chrono::nanoseconds busy{0};  // 执行任务的累计时间 (collect_timing)
+    };
+
+    // 线程池整体的快照; 各项分别读取, 彼此之间不保证是同一时刻的
+    struct Metrics {
+        std::chrono::nanoseconds uptime{0};    // 线程池已运行的时间
+        std::size_t live_workers{0};
+        std::size_t idle_workers{0};           // 正在睡眠的
+        std::size_t queued{0};                 // 所有队列中的任务总数
+        std::array<std::size_t, kLaneCount> lane_depth{};
+        std::vector<WorkerStats> workers;      // 按槽位
+        LatencyHistogram queue_latency;        // 入队到开始执行 (collect_timing)
+        LatencyHistogram run_time;             // 任务执行时间 (collect_timing)
+
+        // 启动以来的平均利用率: 执行任务的时间 / (运行时间 x 当前线程数)
+        // NOTE: 弹性线程池的线程数会变, 这只是近似; 要看一段时间内的利用率, 取两次快照相减
+        double Utilization() const noexcept {
+            std::chrono::nanoseconds busy{0};
+            for (const WorkerStats& w : workers) {
+                busy += w.busy;
+            }
+            const double capacity =
+                static_cast<double>(uptime.count()) * static_cast<double>(live_workers);
+            return capacity > 0 ? static_cast<double>(busy.count()) / capacity : 0.0;
+        }
+    };
+
+    explicit ThreadPool(std::size_t thread_count, ThreadPoolOptions options = {})
+        : options_(options),
+          min_threads_(thread_count),
+          max_threads_(std::max(thread_count, options.max_threads)),
+          timing_(options.collect_timing || options.on_task_begin || options.on_task_end),
+          started_(Clock::now()),
+          stopping_(false) {
         if (thread_count == 0) {
             throw std::invalid_argument("thread_count must be > 0");
         }
-        workers_.reserve(thread_count);
+        options_.spin_min = std::min(options_.spin_min, options_.spin_max);
+        const CpuTopology& topology = CpuTopology::Get();
+        numa_aware_ = options_.affinity != CpuAffinity::kNone && topology.NodeCount() > 1;
+        // NOTE: 先按上限建好所有工作线程的状态, 再启动线程; 工作线程会互相窃取,
+        // 必须看到完整的 states_, 之后扩缩容只启停线程, 不改 states_
+        states_.reserve(max_threads_);
+        for (std::size_t i = 0; i < max_threads_; ++i) {
+            states_.push_back(std::make_unique<WorkerState>());
+            states_.back()->node = NodeOfSlot(i);
+        }
+        idle_workers_.reserve(max_threads_);  // 唤醒路径上不再分配
+        workers_.resize(max_threads_);
         try {
+            // NOTE: 先启动的线程可能已经在尝试扩容, 和它们一样持有 grow_mtx_ 再碰 workers_
+            std::lock_guard lk{grow_mtx_};
             for (std::size_t i = 0; i < thread_count; ++i) {
-                workers_.emplace_back([this] {
-                    this->WorkerLoop();  // 启动工作线程循环
+                SpawnWorker(i);
+            }
+        } catch (...) {
+            // 如果部分线程已创建，确保清理。
+            Shutdown();
+            throw;
+        }
+    }
+
+    // 禁止拷贝和移动
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+
+    ~ThreadPool() { Shutdown(); }
+
+    // 提交任务：接受任意可调用与参数，返回 future<返回类型>。
+    template <class F, class... Args>
+        requires std::invocable<F, Args...>
+    auto Submit(F&& f, Args&&... args) -> std::future<std::invoke_result_t<F, Args...>> {
+        std::future<std::invoke_result_t<F, Args...>> fut;
+        Enqueue(NewPackagedJob(fut, std::forward<F>(f), std::forward<Args>(args)...));
+        return fut;
+    }
+
+    // 指定优先级提交: 总是进入对应车道 (即使在工作线程内调用), 截止时间取车道默认预算
+    template <class F, class... Args>
+        requires std::invocable<F, Args...>
+    auto Submit(Priority priority, F&& f, Args&&... args)
+        -> std::future<std::invoke_result_t<F, Args...>> {
+        std::future<std::invoke_result_t<F, Args...>> fut;
+        EnqueueLane(NewPackagedJob(fut, std::forward<F>(f), std::forward<Args>(args)...), priority,
+                    std::nullopt);
+        return fut;
+    }
+
+    // 指定优先级和截止时间提交: 同一车道内截止时间早的先执行
+    template <class F, class... Args>
+        requires std::invocable<F, Args...>
+    auto Submit(Priority priority, Clock::time_point deadline, F&& f, Args&&... args)
+        -> std::future<std::invoke_result_t<F, Args...>> {
+        std::future<std::invoke_result_t<F, Args...>> fut;
+        EnqueueLane(NewPackagedJob(fut, std::forward<F>(f), std::forward<Args>(args)...), priority,
+                    deadline);
+        return fut;
+    }
+
+    // 提交不关心结果的任务: 没有 packaged_task 和 future 的共享状态
+    // NOTE: 没有 future 承接异常, 任务抛出的异常会导致 std::terminate (与 std::thread 一致)
+    template <class F, class... Args>
+        requires std::invocable<F, Args...>
+    void Post(F&& f, Args&&... args) {
+        Enqueue(NewPostJob(std::forward<F>(f), std::forward<Args>(args)...));
+    }
+
+    template <class F, class... Args>
+        requires std::invocable<F, Args...>
+    void Post(Priority priority, F&& f, Args&&... args) {
+        EnqueueLane(NewPostJob(std::forward<F>(f), std::forward<Args>(args)...), priority,
+                    std::nullopt);
+    }
+
+    template <class F, class... Args>
+        requires std::invocable<F, Args...>
+    void Post(Priority priority, Clock::time_point deadline, F&& f, Args&&... args) {
+        EnqueueLane(NewPostJob(std::forward<F>(f), std::forward<Args>(args)...), priority,
+                    deadline);
+    }
+
+    // 批量提交: 整批只加一次锁、只广播一次; 返回一个在整批任务都完成后就绪的 future
+    // 第一个抛出的异常通过该 future 传出, 其余任务照常执行
+    // NOTE: range 是右值时移动其中的可调用对象, 否则拷贝
+    template <std::ranges::input_range R>
+        requires std::is_invocable_v<std::ranges::range_value_t<R>&>
+    std::future<void> SubmitBatch(R&& range) {
+        using Fn = std::ranges::range_value_t<R>;
+        auto* batch = new BatchState;
+        std::future<void> fut = batch->done.get_future();
+        std::vector<Job*> jobs;
+        if constexpr (std::ranges::sized_range<R>) {
+            jobs.reserve(std::ranges::size(range));
+        }
+        try {
+            for (auto&& f : range) {
+                using Elem = std::conditional_t<std::is_lvalue_reference_v<R>, decltype(f),
+                                                std::remove_reference_t<decltype(f)>>;
+                jobs.push_back(nullptr);  // 先占位, 保证 NewJob 成功后不会因 push_back 泄漏
+                jobs.back() = NewJob([batch, fn = Fn(std::forward<Elem>(f))]() mutable noexcept {
+                    batch->Run(fn);
                 });
             }
-        } catch (...) {
-            // 如果部分线程已创建，确保清理。
-            Shutdown();
-            throw;
+            if (jobs.empty()) {
+                batch->done.set_value();
+                delete batch;
+                return fut;
+            }
+            batch->remaining.store(jobs.size(), std::memory_order_relaxed);
+            Enqueue(jobs);
+        } catch (...) {
+            DeleteJobs(jobs);
+            delete batch;
+            throw;
+        }
+        return fut;
+    }
+
+    // 并行执行 fn(i), i ∈ [begin, end); 调用线程也参与计算, 全部完成后返回
+    // NOTE: 引导式(guided)分块: 每次领取 max(grain, 剩余 / (2 * 参与者数)) 个下标,
+    // 开始时块大、调度开销小, 接近结束时块小、负载均衡好
+    // 第一个异常在所有已领取的块结束后重新抛出, 尚未领取的下标不再执行
+    template <std::integral I, class F>
+    void ParallelFor(I begin, I end, I grain, F&& fn) {
+        if (!(begin < end)) {
+            return;
+        }
+        auto chunk = [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i) {
+                fn(static_cast<I>(begin + static_cast<I>(i)));
+            }
+        };
+        RunChunks(static_cast<std::size_t>(end - begin), ToGrain(grain), chunk);
+    }
+
+    // 并行归约: 每块先从 identity 开始用 reduce 折叠 map(i), 再合并进总结果
+    // NOTE: 块的合并顺序不确定, reduce 需满足结合律和交换律 (浮点求和的结果可能逐次不同)
+    template <std::integral I, class T, class Map, class Reduce>
+    T ParallelReduce(I begin, I end, I grain, T identity, Map&& map, Reduce&& reduce) {
+        T result = identity;
+        if (!(begin < end)) {
+            return result;
+        }
+        std::mutex result_mtx;
+        auto chunk = [&](std::size_t lo, std::size_t hi) {
+            T partial = identity;
+            for (std::size_t i = lo; i < hi; ++i) {
+                auto value = map(static_cast<I>(begin + static_cast<I>(i)));
+                partial = reduce(std::move(partial), std::move(value));
+            }
+            std::lock_guard lk{result_mtx};
+            result = reduce(std::move(result), std::move(partial));
+        };
+        RunChunks(static_cast<std::size_t>(end - begin), ToGrain(grain), chunk);
+        return result;
+    }
+
+    // co_await pool.Schedule(): 挂起当前协程, 由某个工作线程恢复
+    // NOTE: 在工作线程上调用时进入本地队列, 可能被其他线程窃取, 相当于让出当前线程
+    auto Schedule() noexcept {
+        struct Awaiter {
+            ThreadPool* pool;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                pool->Post([h]() noexcept { h.resume(); });
+            }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{this};
+    }
+
+    // 显式关停：阻止新任务、等待队列清空并回收线程。
+    void Shutdown() noexcept {
+        {
+            std::lock_guard lk{mtx_};
+            if (stopping_) {  // 如果已经停止，直接返回
+                return;
+            }
+            stopping_ = true;  // 设置停止标志
+        }
+        // NOTE: 等正在进行的扩容做完; 之后 MaybeGrow 都会看到 stopping_, 不会再碰 workers_
+        std::lock_guard grow_lk{grow_mtx_};
+        // NOTE: 不管在不在空闲栈里, 每个停车位都发一个令牌; 正准备睡眠的线程会看到 stopping_
+        for (auto& state : states_) {
+            state->Unpark();
+        }
+        workers_.clear();  // 清空工作线程 (jthread 会自动 join, 已退出的空槽不可 join)
+    }
+
+    // 当前存活的工作线程数 (弹性线程池会随负载变化)
+    std::size_t Size() const noexcept { return live_.load(std::memory_order_relaxed); }
+    std::size_t MinSize() const noexcept { return min_threads_; }
+    std::size_t MaxSize() const noexcept { return max_threads_; }
+
+    LaneStats GetLaneStats(Priority priority) const {
+        std::lock_guard lk{mtx_};
+        const Lane& lane = lanes_[static_cast<std::size_t>(priority)];
+        LaneStats stats = lane.stats;
+        stats.depth = lane.heap.size();
+        return stats;
+    }
+
+    // 读取时不加锁 (车道深度除外): 计数器只由各自的工作线程写, 这里 relaxed 读
+    Metrics GetMetrics() const {
+        Metrics m;
+        m.uptime = Clock::now() - started_;
+        m.live_workers = live_.load(std::memory_order_relaxed);
+        m.idle_workers = idle_.load(std::memory_order_relaxed);
+        m.queued = queued_.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < kLaneCount; ++i) {
+            m.lane_depth[i] = lanes_[i].depth.load(std::memory_order_relaxed);
+        }
+        m.workers.reserve(states_.size());
+        for (const auto& state : states_) {
+            const WorkerCounters& c = state->counters;
+            WorkerStats& w = m.workers.emplace_back();
+            w.running = state->running.load(std::memory_order_relaxed);
+            w.deque_depth = static_cast<std::size_t>(state->deque.Size());
+            w.local = c.local.load(std::memory_order_relaxed);
+            w.stolen = c.stolen.load(std::memory_order_relaxed);
+            w.from_lanes = c.from_lanes.load(std::memory_order_relaxed);
+            w.tasks = w.local + w.stolen + w.from_lanes;
+            w.parks = c.parks.load(std::memory_order_relaxed);
+            w.busy = std::chrono::nanoseconds{c.busy_ns.load(std::memory_order_relaxed)};
+            for (std::size_t b = 0; b < LatencyHistogram::kBuckets; ++b) {
+                m.queue_latency.counts[b] += c.wait[b].load(std::memory_order_relaxed);
+                m.run_time.counts[b] += c.run[b].load(std::memory_order_relaxed);
+            }
+        }
+        return m;
+    }
+
+private:
+    // 当前线程若是本池的工作线程, 记录池指针和它的编号
+    static inline thread_local ThreadPool* tls_pool_{nullptr};
+    static inline thread_local std::size_t tls_index_{0};
+
+    // 任务节点从 JobNodeCache 取, 执行完还回去
+    template <class F>
+    static Job* NewJob(F&& f) {
+        void* node = JobNodeCache::Acquire();
+        try {
+            return ::new (node) Job{std::forward<F>(f)};
+        } catch (...) {
+            JobNodeCache::Release(node);
+            throw;
+        }
+    }
+
+    // 把 f(args...) 包装成 packaged_task 任务节点, future 通过 fut 带回
+    template <class R, class F, class... Args>
+    static Job* NewPackagedJob(std::future<R>& fut, F&& f, Args&&... args) {
+        // 把原本需要参数的可调用对象 f 与它的参数 args... 预先“拼”好, 变成一个“无参可调用对象”
+        // 并用 packaged_task 包装以拿到 future。
+        // 用 lambda + apply 避免 std::bind 的语义惊喜，完美转发并保持移动
+        auto packer = [fn = std::forward<F>(f),
+                       tup = std::make_tuple(std::forward<Args>(args)...)]() mutable -> R {
+            return std::apply(std::move(fn), std::move(tup));
+        };
+
+        // std::promise + std::future：手动设置结果
+        // std::packaged_task + std::future：任务执行后自动产生结果
+        // 执行 packaged_task 相当于执行它内部的函数，并自动将结果放入 future 对象中
+
+        // NOTE: packaged_task 只能移动, 不能拷贝; 任务队列里是只能移动的 Job, 直接按值捕获即可,
+        // 不再需要 shared_ptr 包装 (std::function 要求可拷贝, 才不得不那样做)
+        std::packaged_task<R()> task{std::move(packer)};
+        fut = task.get_future();  // 获取 future (因为 task 可能在其他线程被调用)
+
+        // NOTE: 将 task 包装为无参<void()>任务。异常由 packaged_task 捕获并传递给 future。
+        return NewJob([task = std::move(task)]() mutable noexcept { task(); });
+    }
+
+    template <class F, class... Args>
+    static Job* NewPostJob(F&& f, Args&&... args) {
+        if constexpr (sizeof...(Args) == 0) {
+            return NewJob(std::forward<F>(f));
+        } else {
+            return NewJob([fn = std::forward<F>(f),
+                           tup = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                std::apply(std::move(fn), std::move(tup));
+            });
+        }
+    }
+
+    static void DeleteJob(Job* job) noexcept {
+        job->~Job();
+        JobNodeCache::Release(job);
+    }
+
+    static void DeleteJobs(std::span<Job* const> jobs) noexcept {
+        for (Job* job : jobs) {
+            if (job != nullptr) {
+                DeleteJob(job);
+            }
+        }
+    }
+
+    void Enqueue(Job* job) {
+        try {
+            Enqueue(std::span<Job* const>{&job, 1});
+        } catch (...) {
+            DeleteJob(job);
+            throw;
+        }
+    }
+
+    // 入队一批任务, 整批只加一次锁; 抛异常时任务的所有权仍归调用方
+    void Enqueue(std::span<Job* const> jobs) {
+        if (tls_pool_ == this) {
+            // NOTE: 工作线程内部提交: 直接压入本地队列, 不碰 mtx_
+            if (stopping_.load(std::memory_order_relaxed)) {
+                throw std::runtime_error("ThreadPool is stopping; cannot submit.");
+            }
+            const auto now = timing_ ? Clock::now() : Clock::time_point{};
+            // NOTE: 先一次性预留, 之后的 Push 不会扩容也就不会抛异常;
+            // 否则中途抛出时前面的任务已经归队列所有, 调用方却会把整批删掉
+            auto& deque = states_[tls_index_]->deque;
+            deque.Reserve(static_cast<int64_t>(jobs.size()));
+            for (Job* job : jobs) {
+                job->SetEnqueueTime(now);
+                deque.Push(job);
+            }
+        } else {
+            // 外部提交进中优先级车道
+            const auto now = Clock::now();
+            const auto deadline = DefaultDeadline(Priority::kNormal, now);
+            std::lock_guard lk{mtx_};
+            if (stopping_) {
+                throw std::runtime_error("ThreadPool is stopping; cannot submit.");
+            }
+            lanes_[static_cast<std::size_t>(Priority::kNormal)].heap.reserve(
+                lanes_[static_cast<std::size_t>(Priority::kNormal)].heap.size() + jobs.size());
+            for (Job* job : jobs) {
+                PushLaneLocked(job, Priority::kNormal, deadline, false, now);
+            }
+        }
+        OnEnqueued(jobs.size());
+    }
+
+    // 进入指定车道, 没给截止时间时取车道默认预算; 失败时释放 job
+    void EnqueueLane(Job* job, Priority priority, std::optional<Clock::time_point> deadline) {
+        const auto now = Clock::now();
+        {
+            std::lock_guard lk{mtx_};
+            if (stopping_) {
+                DeleteJob(job);
+                throw std::runtime_error("ThreadPool is stopping; cannot submit.");
+            }
+            try {
+                PushLaneLocked(job, priority, deadline.value_or(DefaultDeadline(priority, now)),
+                               deadline.has_value(), now);
+            } catch (...) {
+                DeleteJob(job);
+                throw;
+            }
+        }
+        OnEnqueued(1);
+    }
+
+    void OnEnqueued(std::size_t n) {
+        queued_.fetch_add(n, std::memory_order_seq_cst);
+        if (n > 1) {
+            WakeUpTo(n);
+        } else if (searching_.load(std::memory_order_seq_cst) == 0) {
+            // NOTE: 已有线程在找任务时不再唤醒, 由它找到任务后接力唤醒下一个, 避免惊群
+            WakeOne();
+        }
+        MaybeGrow();
+    }
+
+    // --- 优先级车道 ---
+
+    // 没有显式截止时间的任务按车道默认预算计算截止时间: 同一车道内它们保持 FIFO,
+    // 而且会随等待变老, 不会被源源不断的带截止时间的任务永远压在后面
+    static constexpr std::array<std::chrono::microseconds, kLaneCount> kDefaultBudget{
+        std::chrono::milliseconds{1}, std::chrono::milliseconds{100}, std::chrono::seconds{1}};
+
+    // 低车道连续被跳过这么多次后, 下一次优先服务它
+    static constexpr std::size_t kMaxSkips = 16;
+
+    static Clock::time_point DefaultDeadline(Priority priority, Clock::time_point now) noexcept {
+        return now + kDefaultBudget[static_cast<std::size_t>(priority)];
+    }
+
+    struct LaneEntry {
+        Clock::time_point deadline;
+        uint64_t seq;  // 截止时间相同时保持 FIFO
+        Job* job;      // 入队时间记在 Job 里
+        bool explicit_deadline;
+    };
+
+    // std::push_heap 是大顶堆, 比较器取反得到「截止时间最早的在堆顶」
+    struct LaterDeadline {
+        bool operator()(const LaneEntry& a, const LaneEntry& b) const noexcept {
+            return a.deadline != b.deadline ? a.deadline > b.deadline : a.seq > b.seq;
+        }
+    };
+
+    struct Lane {
+        std::vector<LaneEntry> heap;  // 以下均由 mtx_ 保护
+        std::size_t skipped{0};       // 非空却被更高车道抢先的次数
+        LaneStats stats;
+        std::atomic<std::size_t> depth{0};  // heap.size() 的无锁副本, 供 FindJob 快速判断
+    };
+
+    void PushLaneLocked(Job* job, Priority priority, Clock::time_point deadline,
+                        bool explicit_deadline, Clock::time_point now) {
+        Lane& lane = lanes_[static_cast<std::size_t>(priority)];
+        job->SetEnqueueTime(now);
+        lane.heap.push_back({deadline, lane_seq_++, job, explicit_deadline});
+        std::push_heap(lane.heap.begin(), lane.heap.end(), LaterDeadline{});
+        lane.depth.store(lane.heap.size(), std::memory_order_relaxed);
+        lanes_depth_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 从车道取一个任务: 先看有没有饿太久的低车道, 否则取最高的非空车道
+    Job* PopLaneLocked() {
+        Lane* chosen = nullptr;
+        for (std::size_t i = kLaneCount; i-- > 1;) {
+            if (!lanes_[i].heap.empty() && lanes_[i].skipped >= kMaxSkips) {
+                chosen = &lanes_[i];
+                break;
+            }
+        }
+        for (std::size_t i = 0; chosen == nullptr && i < kLaneCount; ++i) {
+            if (!lanes_[i].heap.empty()) {
+                chosen = &lanes_[i];
+            }
+        }
+        if (chosen == nullptr) {
+            return nullptr;
+        }
+        for (Lane* lower = chosen + 1; lower != lanes_.data() + kLaneCount; ++lower) {
+            if (!lower->heap.empty()) {
+                ++lower->skipped;
+            }
+        }
+        chosen->skipped = 0;
+
+        std::pop_heap(chosen->heap.begin(), chosen->heap.end(), LaterDeadline{});
+        LaneEntry entry = chosen->heap.back();
+        chosen->heap.pop_back();
+        chosen->depth.store(chosen->heap.size(), std::memory_order_relaxed);
+        lanes_depth_.fetch_sub(1, std::memory_order_relaxed);
+
+        const auto now = Clock::now();
+        const auto wait =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - entry.job->EnqueueTime());
+        ++chosen->stats.dispatched;
+        chosen->stats.total_wait += wait;
+        chosen->stats.max_wait = std::max(chosen->stats.max_wait, wait);
+        if (entry.explicit_deadline && now > entry.deadline) {
+            ++chosen->stats.deadline_misses;
+        }
+        return entry.job;
+    }
+
+    // 每个工作线程(槽位)的计数器: 只有槽位上的线程写, 所以不用原子读改写, load + store 即可
+    struct WorkerCounters {
+        std::atomic<uint64_t> local{0};
+        std::atomic<uint64_t> stolen{0};
+        std::atomic<uint64_t> from_lanes{0};
+        std::atomic<uint64_t> parks{0};
+        std::atomic<int64_t> busy_ns{0};
+        std::array<std::atomic<uint64_t>, LatencyHistogram::kBuckets> wait{};
+        std::array<std::atomic<uint64_t>, LatencyHistogram::kBuckets> run{};
+
+        template <class T>
+        static void Add(std::atomic<T>& counter, T delta = 1) noexcept {
+            counter.store(counter.load(std::memory_order_relaxed) + delta,
+                          std::memory_order_relaxed);
+        }
+    };
+
+    // 每个工作线程(槽位)的状态; 各自独占缓存行, 避免停车令牌和自旋预算与邻居伪共享
+    // NOTE: 槽位在线程池的整个生命周期内都在, 线程退出后槽位可以再启动一个新线程
+    struct alignas(64) WorkerState {
+        WorkStealingDeque<Job*> deque;
+        // 停车位: 每个令牌对应一次唤醒; 只有从空闲栈取走该线程的唤醒者和 Shutdown 会发令牌
+        // NOTE: 用 C++20 信号量而不是 atomic wait, 因为退出空闲线程需要带超时的等待
+        std::counting_semaphore<> wake_tokens{0};
+        std::chrono::nanoseconds spin_budget{0};  // 仅本线程读写
+        std::size_t node{0};                      // 绑定的 NUMA 节点, 构造后不变
+        std::atomic<bool> running{false};         // 槽位上有没有线程 (grow_mtx_ 下启动)
+        WorkerCounters counters;
+
+        // 等到有令牌为止
+        void Park() noexcept { wake_tokens.acquire(); }
+
+        // 超时返回 false
+        bool ParkFor(std::chrono::milliseconds timeout) noexcept {
+            return wake_tokens.try_acquire_for(timeout);
+        }
+
+        void Unpark() noexcept { wake_tokens.release(); }
+    };
+
+    // NOTE: 与 WorkerLoop 构成 Dekker 式握手(都用 seq_cst):
+    // 要么这里看到 idle_ > 0 去唤醒, 要么准备睡眠的工作线程看到 queued_ > 0 不睡
+    void WakeOne() { WakeUpTo(1); }
+
+    // 定向唤醒至多 n 个空闲线程: 从空闲栈顶取(最近睡下的, 缓存最热), 只唤醒被取出的那几个
+    void WakeUpTo(std::size_t n) {
+        if (idle_.load(std::memory_order_seq_cst) == 0) {
+            return;
+        }
+        std::size_t picked[8];
+        std::size_t count = 0;
+        const std::size_t node = numa_aware_ ? CallerNode() : 0;
+        {
+            std::lock_guard lk{idle_mtx_};
+            while (count < std::min<std::size_t>(n, std::size(picked)) && !idle_workers_.empty()) {
+                // NOTE: 绑核时优先唤醒与提交方同节点的线程, 任务的数据多半还在本节点的缓存里
+                std::size_t pos = idle_workers_.size() - 1;
+                for (std::size_t k = pos + 1; numa_aware_ && k-- > 0;) {
+                    if (states_[idle_workers_[k]]->node == node) {
+                        pos = k;
+                        break;
+                    }
+                }
+                picked[count++] = idle_workers_[pos];
+                idle_workers_.erase(idle_workers_.begin() + pos);
+            }
+            idle_.store(idle_workers_.size(), std::memory_order_seq_cst);
+        }
+        // NOTE: 一次最多直接唤醒 8 个, 其余由被唤醒者找到任务后接力唤醒
+        for (std::size_t i = 0; i < count; ++i) {
+            states_[picked[i]]->Unpark();
+        }
+    }
+
+    // 没任务时先自旋等一会: 前 kPauseSpins 次用 pause, 之后让出 CPU
+    // 返回 true 表示等到了任务 (或线程池在停止); 自旋预算据此加倍或减半
+    bool SpinForWork(WorkerState& state) {
+        static constexpr uint32_t kPauseSpins = 64;
+        const auto budget = state.spin_budget;
+        if (budget.count() == 0) {
+            return false;
+        }
+        const auto deadline = Clock::now() + budget;
+        for (uint32_t i = 0;; ++i) {
+            if (queued_.load(std::memory_order_seq_cst) > 0 ||
+                stopping_.load(std::memory_order_relaxed)) {
+                state.spin_budget =
+                    std::min<std::chrono::nanoseconds>(budget * 2, options_.spin_max);
+                return true;
+            }
+            if (i < kPauseSpins) {
+                CpuRelax();
+            } else {
+                std::this_thread::yield();
+            }
+            if (i % 16 == 15 && Clock::now() >= deadline) {
+                break;
+            }
+        }
+        state.spin_budget = std::max<std::chrono::nanoseconds>(budget / 2, options_.spin_min);
+        return false;
+    }
+
+    static void CpuRelax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    // 从空闲栈撤销自己的登记; 已被某个唤醒者取走时返回 false (它的令牌马上就到, 或已到)
+    bool Unlist(std::size_t index) {
+        auto it = std::find(idle_workers_.begin(), idle_workers_.end(), index);
+        if (it == idle_workers_.end()) {
+            return false;
+        }
+        idle_workers_.erase(it);
+        idle_.store(idle_workers_.size(), std::memory_order_seq_cst);
+        return true;
+    }
+
+    // 把自己登记到空闲栈后睡眠; 登记后发现有任务就撤销登记直接返回
+    // 返回 false 表示这个线程该退出了: 线程数高于下限, 且空闲了 idle_timeout 没被唤醒
+    bool Park(std::size_t index) {
+        WorkerCounters::Add(states_[index]->counters.parks);
+        {
+            std::lock_guard lk{idle_mtx_};
+            idle_workers_.push_back(index);
+            idle_.store(idle_workers_.size(), std::memory_order_seq_cst);
+        }
+        if (queued_.load(std::memory_order_seq_cst) > 0 ||
+            stopping_.load(std::memory_order_seq_cst)) {
+            std::lock_guard lk{idle_mtx_};
+            if (Unlist(index)) {
+                return true;
+            }
+        } else if (max_threads_ > min_threads_) {
+            return ParkOrRetire(index);
+        }
+        states_[index]->Park();
+        return true;
+    }
+
+    // 弹性线程池的睡眠: 每 idle_timeout 醒一次, 线程数高于下限就撤销登记并退出
+    bool ParkOrRetire(std::size_t index) {
+        WorkerState& state = *states_[index];
+        while (!state.ParkFor(options_.idle_timeout)) {
+            std::unique_lock lk{idle_mtx_};
+            if (live_.load(std::memory_order_relaxed) <= min_threads_) {
+                continue;  // 已在下限, 继续等
+            }
+            if (!Unlist(index)) {
+                lk.unlock();
+                state.Park();  // 超时的同时被唤醒了, 消费掉令牌
+                return true;
+            }
+            // NOTE: 在 idle_mtx_ 下检查并扣减, 同时超时的几个线程不会把线程数扣到下限以下
+            live_.fetch_sub(1, std::memory_order_seq_cst);
+            lk.unlock();
+            // 撤销登记之后又来了任务(或要停止)就不退出: 提交方可能已经找不到可唤醒的线程
+            if (queued_.load(std::memory_order_seq_cst) > 0 ||
+                stopping_.load(std::memory_order_seq_cst)) {
+                live_.fetch_add(1, std::memory_order_seq_cst);
+                return true;
+            }
+            return false;
+        }
+        return true;
+    }
+
+    // --- 弹性扩容与绑核 ---
+
+    // 在槽位 index 上启动工作线程 (构造函数中, 或持有 grow_mtx_ 时)
+    void SpawnWorker(std::size_t index) {
+        WorkerState& state = *states_[index];
+        if (workers_[index].joinable()) {
+            workers_[index].join();  // 上一个线程已退出 (running 为 false), 回收它
+        }
+        state.spin_budget = options_.spin_max;
+        state.running.store(true, std::memory_order_relaxed);
+        live_.fetch_add(1, std::memory_order_seq_cst);
+        try {
+            workers_[index] = std::jthread([this, index] {
+                PinToSlot(index);
+                this->WorkerLoop(index);  // 启动工作线程循环
+                states_[index]->running.store(false, std::memory_order_release);
+            });
+        } catch (...) {
+            live_.fetch_sub(1, std::memory_order_seq_cst);
+            state.running.store(false, std::memory_order_relaxed);
+            throw;
+        }
+    }
+
+    // 所有线程都在忙 (没有空闲或正在找任务的), 且积压的任务比线程还多时, 加一个线程
+    // NOTE: 尽力而为: 别人正在扩容就跳过, 创建线程失败也不影响已入队的任务
+    void MaybeGrow() noexcept {
+        if (max_threads_ == min_threads_ ||
+            live_.load(std::memory_order_relaxed) >= max_threads_ ||
+            idle_.load(std::memory_order_relaxed) > 0 ||
+            searching_.load(std::memory_order_relaxed) > 0 ||
+            queued_.load(std::memory_order_relaxed) <= live_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        std::unique_lock lk{grow_mtx_, std::try_to_lock};
+        if (!lk.owns_lock() || stopping_.load(std::memory_order_seq_cst) ||
+            live_.load(std::memory_order_relaxed) >= max_threads_) {
+            return;
+        }
+        for (std::size_t i = 0; i < states_.size(); ++i) {
+            if (!states_[i]->running.load(std::memory_order_acquire)) {
+                try {
+                    SpawnWorker(i);
+                } catch (...) {
+                }
+                return;
+            }
         }
     }
 
-    // 禁止拷贝和移动
-    ThreadPool(const ThreadPool&) = delete;
-    ThreadPool(ThreadPool&&) = delete;
+    // 槽位 index 所属的节点: kCore 按铺开顺序, kNumaNode 在各节点间轮转
+    std::size_t NodeOfSlot(std::size_t index) const {
+        const CpuTopology& topology = CpuTopology::Get();
+        switch (options_.affinity) {
+            case CpuAffinity::kCore:
+                return topology.NodeOf(topology.Cpus()[index % topology.CpuCount()]);
+            case CpuAffinity::kNumaNode:
+                return index % topology.NodeCount();
+            case CpuAffinity::kNone:
+                break;
+        }
+        return 0;
+    }
 
-    ~ThreadPool() { Shutdown(); }
+    // 在工作线程开头调用; 绑核失败(比如被 cgroup 限制)时照常运行
+    void PinToSlot(std::size_t index) const noexcept {
+        const CpuTopology& topology = CpuTopology::Get();
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        switch (options_.affinity) {
+            case CpuAffinity::kCore:
+                CPU_SET(topology.Cpus()[index % topology.CpuCount()], &set);
+                break;
+            case CpuAffinity::kNumaNode:
+                for (int cpu : topology.NodeCpus(states_[index]->node)) {
+                    CPU_SET(cpu, &set);
+                }
+                break;
+            case CpuAffinity::kNone:
+                return;
+        }
+        ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+    }
 
-    // 提交任务：接受任意可调用与参数，返回 future<返回类型>。
-    template <class F, class... Args>
-    auto Submit(F&& f, Args&&... args) -> std::future<std::invoke_result_t<F, Args...>> {
-        using R = std::invoke_result_t<F, Args...>;
+    // 提交方所在的节点: 工作线程取自己槽位的节点, 外部线程看当前运行在哪个 CPU 上
+    std::size_t CallerNode() const noexcept {
+        return tls_pool_ == this ? states_[tls_index_]->node : CpuTopology::Get().CurrentNode();
+    }
 
-        // 把原本需要参数的可调用对象 f 与它的参数 args... 预先“拼”好, 变成一个“无参可调用对象”
-        // 并用 packaged_task 包装以拿到 future。
-        // 用 lambda + apply 避免 std::bind 的语义惊喜，完美转发并保持移动
-        auto packer = [fn = std::forward<F>(f),
-                       tup = std::make_tuple(std::forward<Args>(args)...)]() mutable -> R {
-            return std::apply(std::move(fn), std::move(tup));
-        };
+    // SubmitBatch 的共享状态, 最后一个完成的任务负责设置 future 并释放它
+    struct BatchState {
+        std::atomic<std::size_t> remaining{0};
+        std::promise<void> done;
+        std::mutex mtx;
+        std::exception_ptr error;  // 第一个异常 (mtx 保护)
 
-        // std::promise + std::future：手动设置结果
-        // std::packaged_task + std::future：任务执行后自动产生结果
-        // 执行 packaged_task 相当于执行它内部的函数，并自动将结果放入 future 对象中
+        template <class Fn>
+        void Run(Fn& fn) noexcept {
+            try {
+                fn();
+            } catch (...) {
+                std::lock_guard lk{mtx};
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                if (error) {
+                    done.set_exception(error);
+                } else {
+                    done.set_value();
+                }
+                delete this;
+            }
+        }
+    };
 
-        // HACK: packaged_task 只能移动, 不能拷贝, 所以需要智能指针包装
-        // 不然 lambda 里面只能引用捕获, 但是 packaged_task 栈上变量离开作用域自动销毁, 造成悬垂引用
-        // 此外, 任务队列是 std::function, 它具有值语义, 要求所包装的可调用对象必须是可拷贝构造的
-        auto task = std::make_shared<std::packaged_task<R()>>(std::move(packer));
-        std::future<R> fut = task->get_future();  // 获取 future (因为 task 可能在其他线程被调用)
+    // ParallelFor / ParallelReduce 的共享状态
+    // NOTE: 放在堆上由 shared_ptr 管理: 排队的辅助任务可能在调用方返回之后才开始执行,
+    // 那时它只会发现没有剩余的块, 不会再碰调用方栈上的 fn
+    template <class ChunkFn>
+    struct ChunkState {
+        ChunkState(ChunkFn& f, std::size_t n, std::size_t g, std::size_t p)
+            : fn(&f), total(n), grain(g), participants(p) {}
 
-        {
+        ChunkFn* fn;
+        const std::size_t total;
+        const std::size_t grain;
+        const std::size_t participants;
+        std::atomic<std::size_t> next{0};       // 下一个未领取的下标
+        std::atomic<std::size_t> completed{0};  // 已完成(或已放弃)的下标数
+        std::mutex mtx;
+        std::exception_ptr error;  // 第一个异常 (mtx 保护)
+
+        // 领取 [lo, hi), 没有剩余时返回 false
+        bool Claim(std::size_t& lo, std::size_t& hi) noexcept {
+            std::size_t cur = next.load(std::memory_order_relaxed);
+            while (cur < total) {
+                std::size_t chunk =
+                    std::min(total - cur, std::max(grain, (total - cur) / (2 * participants)));
+                if (next.compare_exchange_weak(cur, cur + chunk, std::memory_order_relaxed)) {
+                    lo = cur;
+                    hi = cur + chunk;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void Work() noexcept {
+            std::size_t lo = 0;
+            std::size_t hi = 0;
+            while (Claim(lo, hi)) {
+                std::size_t done = hi - lo;
+                try {
+                    (*fn)(lo, hi);
+                } catch (...) {
+                    {
+                        std::lock_guard lk{mtx};
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                    // 放弃所有未领取的下标, 也计入 completed, 让调用方能等到结束
+                    std::size_t rest = next.exchange(total, std::memory_order_relaxed);
+                    done += total - rest;
+                }
+                if (completed.fetch_add(done, std::memory_order_acq_rel) + done == total) {
+                    completed.notify_all();
+                }
+            }
+        }
+    };
+
+    template <std::integral I>
+    static std::size_t ToGrain(I grain) noexcept {
+        return grain > I{0} ? static_cast<std::size_t>(grain) : 1;
+    }
+
+    // 把 [0, total) 分块交给 chunk_fn(lo, hi): 入队 参与者数 - 1 个辅助任务, 调用线程自己也干活
+    template <class ChunkFn>
+    void RunChunks(std::size_t total, std::size_t grain, ChunkFn& chunk_fn) {
+        const std::size_t participants = std::min(Size() + 1, (total + grain - 1) / grain);
+        auto state = std::make_shared<ChunkState<ChunkFn>>(chunk_fn, total, grain, participants);
+        if (participants > 1) {
+            std::vector<Job*> helpers(participants - 1, nullptr);
+            try {
+                for (Job*& job : helpers) {
+                    job = NewJob([state]() noexcept { state->Work(); });
+                }
+                Enqueue(helpers);
+            } catch (...) {
+                DeleteJobs(helpers);
+                throw;
+            }
+        }
+        state->Work();
+        // NOTE: 调用方做完了所有它能领到的块, 这里只等别人手上正在执行的块
+        for (std::size_t c = state->completed.load(std::memory_order_acquire); c != total;
+             c = state->completed.load(std::memory_order_acquire)) {
+            state->completed.wait(c, std::memory_order_acquire);
+        }
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
+
+    // 找任务: 高优先级车道 -> 本地队列 -> 其余车道 -> 随机窃取
+    // NOTE: 车道深度的无锁读只是提示; 读到 0 而错过的任务仍计在 queued_ 里, 工作线程不会睡下
+    Job* FindJob(std::size_t index) {
+        WorkerCounters& counters = states_[index]->counters;
+        Job* job{nullptr};
+        if (lanes_[static_cast<std::size_t>(Priority::kHigh)].depth.load(
+                std::memory_order_relaxed) > 0) {
             std::lock_guard lk{mtx_};
-            if (stopping_) {
-                throw std::runtime_error("ThreadPool is stopping; cannot submit.");
+            if ((job = PopLaneLocked()) != nullptr) {
+                WorkerCounters::Add(counters.from_lanes);
+                return job;
             }
-            // NOTE: 将 task 包装为无参<void()>任务，并添加到任务队列
-            // 在工作线程中执行任务。异常由 packaged_task 捕获并传递给 future。
-            tasks_.emplace([task]() noexcept { (*task)(); });
         }
-        cv_.notify_one();
-        return fut;
+        if (states_[index]->deque.Pop(job)) {
+            WorkerCounters::Add(counters.local);
+            return job;
+        }
+        if (lanes_depth_.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard lk{mtx_};
+            if ((job = PopLaneLocked()) != nullptr) {
+                WorkerCounters::Add(counters.from_lanes);
+                return job;
+            }
+        }
+        // 从随机的受害者开始, 把其他所有队列都试一遍; 绑核时先试同节点的, 再跨节点
+        // NOTE: 没有线程的槽位队列一定是空的 (线程只在本地队列为空时退出), 试一下也很便宜
+        const std::size_t n = states_.size();
+        const std::size_t start = NextRandom() % n;
+        const std::size_t node = states_[index]->node;
+        for (int pass = numa_aware_ ? 0 : 1; pass < 2; ++pass) {
+            for (std::size_t k = 0; k < n; ++k) {
+                std::size_t victim = (start + k) % n;
+                const bool same_node = states_[victim]->node == node;
+                if (victim == index || (numa_aware_ && same_node != (pass == 0))) {
+                    continue;
+                }
+                if (states_[victim]->deque.Steal(job)) {
+                    WorkerCounters::Add(counters.stolen);
+                    return job;
+                }
+            }
+        }
+        return nullptr;
     }
 
-    // 显式关停：阻止新任务、等待队列清空并回收线程。
-    void Shutdown() noexcept {
+    // 执行并释放一个任务; 开启计时时记录排队/执行时间并调用钩子
+    void RunJob(std::size_t index, Job* job) {
+        if (!timing_) {
+            (*job)();
+            DeleteJob(job);
+            return;
+        }
+        WorkerCounters& counters = states_[index]->counters;
+        TaskEvent event{index, job->EnqueueTime(), Clock::now(), {}};
+        const std::chrono::nanoseconds waited = event.begin - event.enqueued;
+        WorkerCounters::Add(counters.wait[LatencyHistogram::BucketOf(waited)]);
+        if (options_.on_task_begin) {
+            options_.on_task_begin(event);
+        }
+        (*job)();
+        event.end = Clock::now();
+        const std::chrono::nanoseconds ran = event.end - event.begin;
+        WorkerCounters::Add(counters.busy_ns, static_cast<int64_t>(ran.count()));
+        WorkerCounters::Add(counters.run[LatencyHistogram::BucketOf(ran)]);
+        DeleteJob(job);
+        if (options_.on_task_end) {
+            options_.on_task_end(event);
+        }
+    }
+
+    // 工作线程循环
+    void WorkerLoop(std::size_t index) {
+        tls_pool_ = this;
+        tls_index_ = index;
+        bool searching = false;  // 刚被唤醒、还没找到任务
+        while (true) {
+            if (Job* job = FindJob(index)) {
+                queued_.fetch_sub(1, std::memory_order_seq_cst);
+                if (std::exchange(searching, false) &&
+                    searching_.fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+                    queued_.load(std::memory_order_seq_cst) > 0) {
+                    WakeOne();  // 最后一个寻找者找到了任务, 还有剩余就接力唤醒下一个
+                }
+                MaybeGrow();
+                // NOTE: 在锁外执行任务，避免阻塞生产者或其他工作线程。
+                RunJob(index, job);
+                continue;
+            }
+
+            if (stopping_.load(std::memory_order_seq_cst) &&
+                queued_.load(std::memory_order_seq_cst) == 0) {  // 停止且队列空
+                if (searching) {
+                    searching_.fetch_sub(1, std::memory_order_seq_cst);
+                }
+                return;  // NOTE: 工作线程会消费完所有任务, 然后退出
+            }
+            // NOTE: 自旋期间也算「正在找任务」, 提交方看到它就不再唤醒别人
+            if (!std::exchange(searching, true)) {
+                searching_.fetch_add(1, std::memory_order_seq_cst);
+            }
+            if (SpinForWork(*states_[index])) {
+                continue;
+            }
+            searching = false;
+            searching_.fetch_sub(1, std::memory_order_seq_cst);
+            // 等到有任务，或线程池进入停止状态。
+            // NOTE: queued_ > 0 但任务正被别人取走时会醒来白跑一趟, 这是有界的
+            if (!Park(index)) {
+                return;  // 空闲超时, 线程数收缩
+            }
+            searching = true;
+            searching_.fetch_add(1, std::memory_order_seq_cst);
+        }
+    }
+
+    static std::size_t NextRandom() noexcept {
+        // xorshift64, 每个线程各自一份状态
+        static thread_local uint64_t state =
+            std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return static_cast<std::size_t>(state);
+    }
+
+    ThreadPoolOptions options_;
+    const std::size_t min_threads_;
+    const std::size_t max_threads_;
+    bool numa_aware_{false};                                      // 绑核且不止一个节点
+    const bool timing_;                                           // 记录排队/执行时间
+    const Clock::time_point started_;
+    mutable std::mutex mtx_;                                      // 互斥锁 (保护车道)
+    std::vector<std::unique_ptr<WorkerState>> states_;            // 每个工作线程的状态
+    std::mutex idle_mtx_;                                         // 保护 idle_workers_
+    std::vector<std::size_t> idle_workers_;                       // 正在睡眠的工作线程编号 (栈)
+    // 注入队列: 外部提交和指定优先级的任务 (mtx_ 保护); 堆用 vector 存放, 稳态下不分配
+    std::array<Lane, kLaneCount> lanes_;
+    uint64_t lane_seq_{0};                                        // 入车道序号 (mtx_ 保护)
+    std::atomic<std::size_t> lanes_depth_{0};                     // 所有车道的任务总数
+    std::atomic<std::size_t> queued_{0};                          // 所有队列中的任务总数
+    std::atomic<std::size_t> idle_{0};                            // idle_workers_.size() 的副本
+    std::atomic<std::size_t> searching_{0};                       // 被唤醒后正在找任务的线程数
+    std::atomic<std::size_t> live_{0};                            // 存活的工作线程数
+    std::mutex grow_mtx_;                                         // 串行化扩容与 Shutdown
+    std::atomic<bool> stopping_;                                  // 停止标志
+    std::vector<std::jthread> workers_;  // 每个槽位的线程 (C++20 jthread), 最后声明, 最先析构
+};
+
+// 把任务执行记录成 Chrome trace JSON (chrome://tracing 或 ui.perfetto.dev 打开)
+// 每个任务是一个 "X" 事件, tid 是工作线程槽位, args.wait_us 是它排了多久的队:
+// 长任务后面紧跟着一串 wait_us 很大的短任务, 就是队头阻塞
+// NOTE: 事件按 worker 分片存放, 每片一把锁; 工作线程只碰自己的那片, 锁基本不会有竞争
+class ChromeTraceWriter {
+public:
+    explicit ChromeTraceWriter(std::size_t max_events = 1 << 20, std::size_t shards = 64)
+        : origin_(std::chrono::steady_clock::now()),
+          per_shard_(std::max<std::size_t>(max_events / std::max<std::size_t>(shards, 1), 1)),
+          shards_(std::max<std::size_t>(shards, 1)) {}
+
+    // 禁止拷贝和移动: 钩子里存的是 this
+    ChromeTraceWriter(const ChromeTraceWriter&) = delete;
+    ChromeTraceWriter& operator=(const ChromeTraceWriter&) = delete;
+
+    // 作为 ThreadPoolOptions::on_task_end 使用; writer 必须比线程池活得久
+    TaskHook Hook() {
+        return [this](const TaskEvent& event) { Record(event); };
+    }
+
+    // 超过容量的事件直接丢弃并计数, 不会无限占用内存
+    void Record(const TaskEvent& event) noexcept {
+        Shard& shard = shards_[event.worker % shards_.size()];
+        std::lock_guard lk{shard.mtx};
+        if (shard.events.size() >= per_shard_) {
+            ++shard.dropped;
+            return;
+        }
+        if (shard.events.capacity() == 0) {
+            shard.events.reserve(std::min<std::size_t>(per_shard_, 4096));
+        }
+        shard.events.push_back(event);
+    }
+
+    std::size_t Size() const {
+        std::size_t n = 0;
+        for (const Shard& shard : shards_) {
+            std::lock_guard lk{shard.mtx};
+            n += shard.events.size();
+        }
+        return n;
+    }
+
+    uint64_t Dropped() const {
+        uint64_t n = 0;
+        for (const Shard& shard : shards_) {
+            std::lock_guard lk{shard.mtx};
+            n += shard.dropped;
+        }
+        return n;
+    }
+
+    void Write(std::ostream& out) const {
+        auto us = [this](std::chrono::steady_clock::time_point t) {
+            return std::chrono::duration<double, std::micro>(t - origin_).count();
+        };
+        bool first = true;
+        auto separator = [&first] { return std::exchange(first, false) ? "\n" : ",\n"; };
+        std::vector<std::size_t> workers;
+        out << "{\"traceEvents\":[";
+        for (const Shard& shard : shards_) {
+            std::lock_guard lk{shard.mtx};
+            for (const TaskEvent& e : shard.events) {
+                out << separator() << R"({"name":"task","ph":"X","pid":1,"tid":)" << e.worker
+                    << R"(,"ts":)" << us(e.begin) << R"(,"dur":)" << us(e.end) - us(e.begin)
+                    << R"(,"args":{"wait_us":)" << us(e.begin) - us(e.enqueued) << "}}";
+                if (std::find(workers.begin(), workers.end(), e.worker) == workers.end()) {
+                    workers.push_back(e.worker);
+                }
+            }
+        }
+        // 线程名元数据, 让时间线上显示 worker N
+        for (std::size_t w : workers) {
+            out << separator() << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << w
+                << R"(,"args":{"name":"worker )" << w << "\"}}";
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+private:
+    struct alignas(64) Shard {
+        mutable std::mutex mtx;
+        std::vector<TaskEvent> events;
+        uint64_t dropped{0};
+    };
+
+    const std::chrono::steady_clock::time_point origin_;
+    const std::size_t per_shard_;
+    std::vector<Shard> shards_;
+};
+
+// --- 基准测试 ---
+
+// 原来的单队列线程池: 一把 mtx_ 保护一个 std::queue, 作为对比基线
+class MutexQueuePool {
+public:
+    explicit MutexQueuePool(std::size_t thread_count) {
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            workers_.emplace_back([this] { WorkerLoop(); });
+        }
+    }
+
+    ~MutexQueuePool() {
         {
             std::lock_guard lk{mtx_};
-            if (stopping_) {  // 如果已经停止，直接返回
-                return;
-            }
-            stopping_ = true;  // 设置停止标志
+            stopping_ = true;
         }
         cv_.notify_all();
-        workers_.clear();  // 清空工作线程 (jthread 会自动 join)
+        workers_.clear();
     }
 
-    std::size_t Size() const noexcept { return workers_.size(); }
+    // 与 ThreadPool::Submit 相同的 packaged_task + future 包装, 只有入队方式不同
+    template <class F>
+    auto Submit(F&& f) -> std::future<std::invoke_result_t<F>> {
+        using R = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        std::future<R> fut = task->get_future();
+        {
+            std::lock_guard lk{mtx_};
+            tasks_.emplace([task]() noexcept { (*task)(); });
+        }
+        cv_.notify_one();
+        return fut;
+    }
 
 private:
-    // 工作线程循环
     void WorkerLoop() {
         while (true) {
-            std::function<void()> job;  // 任务
+            std::function<void()> job;
             {
                 std::unique_lock lk{mtx_};
-                // 等到有任务，或线程池进入停止状态。
                 cv_.wait(lk, [this] { return stopping_ || !tasks_.empty(); });
-                if (stopping_ && tasks_.empty()) {  // 停止且队列空，安全退出
-                    return;                         // NOTE: 工作线程会消费完所有任务, 然后退出
+                if (stopping_ && tasks_.empty()) {
+                    return;
                 }
-                job = std::move(tasks_.front());  // 从队列中取出任务
+                job = std::move(tasks_.front());
                 tasks_.pop();
             }
-            // NOTE: 在锁外执行任务，避免阻塞生产者或其他工作线程。
             job();
         }
     }
 
-    mutable std::mutex mtx_;                   // 互斥锁
-    std::condition_variable cv_;               // 条件变量
-    std::vector<std::jthread> workers_;        // 工作线程 (C++20 jthread)
-    std::queue<std::function<void()>> tasks_;  // 任务队列
-    bool stopping_;                            // 停止标志
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::queue<std::function<void()>> tasks_;
+    bool stopping_{false};
+    std::vector<std::jthread> workers_;
 };
 
-int main() {}
\ No newline at end of file
+// 约 1µs 的忙等任务
+void SpinFor(std::chrono::nanoseconds d) {
+    auto end = std::chrono::steady_clock::now() + d;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+// 外部提交 kSpawners 个任务, 每个再在工作线程内提交 total_tasks / kSpawners 个忙等 work 的小任务
+// kPost 为 true 时小任务用 Post 提交, 否则用 Submit; 返回每秒完成的小任务数 (百万)
+template <typename Pool, bool kPost = false>
+double BenchFineGrained(std::size_t threads, std::size_t total_tasks,
+                        std::chrono::nanoseconds work) {
+    constexpr std::size_t kSpawners = 64;
+    const std::size_t per_spawner = total_tasks / kSpawners;
+    std::atomic<std::size_t> remaining{per_spawner * kSpawners};
+    std::promise<void> done;
+
+    Pool pool{threads};
+    auto leaf = [&] {
+        if (work.count() > 0) {
+            SpinFor(work);
+        }
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            done.set_value();
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t s = 0; s < kSpawners; ++s) {
+        pool.Submit([&] {
+            for (std::size_t i = 0; i < per_spawner; ++i) {
+                if constexpr (kPost) {
+                    pool.Post(leaf);
+                } else {
+                    pool.Submit(leaf);
+                }
+            }
+        });
+    }
+    done.get_future().wait();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(per_spawner * kSpawners) / elapsed.count() / 1e6;
+}
+
+void RunFineGrained(std::size_t total_tasks, std::chrono::nanoseconds work) {
+    std::cout << "threads\tMutexQueue\tSubmit\t\tPost" << std::endl;
+    for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+        double baseline = BenchFineGrained<MutexQueuePool>(threads, total_tasks, work);
+        double submit = BenchFineGrained<ThreadPool>(threads, total_tasks, work);
+        double post = BenchFineGrained<ThreadPool, true>(threads, total_tasks, work);
+        std::cout << threads << "\t" << baseline << "\t\t" << submit << "\t\t" << post
+                  << std::endl;
+    }
+}
+
+// cpp/test/matrix_multiply.cpp 中的 Multiply (i-k-j 循环顺序)
+using Matrix = std::vector<std::vector<int64_t>>;
+
+int64_t Multiply(const Matrix& mat_a, const Matrix& mat_b) {
+    const size_t n = mat_a.size();
+    Matrix mat_c(n, std::vector<int64_t>(n, 0));
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t k = 0; k < n; ++k) {
+            const int64_t r = mat_a[i][k];
+            for (size_t j = 0; j < n; ++j) {
+                mat_c[i][j] += r * mat_b[k][j];
+            }
+        }
+    }
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            sum += mat_c[i][j];
+        }
+    }
+    return sum;
+}
+
+// 同样的计算按行并行: C 的第 i 行只由领到 i 的那个块写, 不需要同步
+int64_t ParallelMultiply(ThreadPool& pool, const Matrix& mat_a, const Matrix& mat_b) {
+    const size_t n = mat_a.size();
+    Matrix mat_c(n, std::vector<int64_t>(n, 0));
+    pool.ParallelFor(size_t{0}, n, size_t{1}, [&](size_t i) {
+        for (size_t k = 0; k < n; ++k) {
+            const int64_t r = mat_a[i][k];
+            for (size_t j = 0; j < n; ++j) {
+                mat_c[i][j] += r * mat_b[k][j];
+            }
+        }
+    });
+    return pool.ParallelReduce(
+        size_t{0}, n, size_t{16}, int64_t{0},
+        [&](size_t i) {
+            int64_t row = 0;
+            for (int64_t v : mat_c[i]) {
+                row += v;
+            }
+            return row;
+        },
+        std::plus<>{});
+}
+
+Matrix MakeMatrix(size_t n, int64_t seed) {
+    Matrix m(n, std::vector<int64_t>(n));
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            m[i][j] = static_cast<int64_t>((i * 31 + j * 17 + static_cast<size_t>(seed)) % 100);
+        }
+    }
+    return m;
+}
+
+// 外部线程提交 tasks 个空任务: 逐个 Post 与一次 SubmitBatch 的对比, 返回 Mtasks/s
+double BenchExternalSubmit(std::size_t threads, std::size_t tasks, bool batch) {
+    ThreadPool pool{threads};
+    std::atomic<std::size_t> remaining{tasks};
+    auto leaf = [&remaining] { remaining.fetch_sub(1, std::memory_order_relaxed); };
+    auto start = std::chrono::steady_clock::now();
+    if (batch) {
+        std::vector<decltype(leaf)> jobs(tasks, leaf);
+        pool.SubmitBatch(std::move(jobs)).wait();
+    } else {
+        for (std::size_t i = 0; i < tasks; ++i) {
+            pool.Post(leaf);
+        }
+        while (remaining.load(std::memory_order_relaxed) != 0) {
+            std::this_thread::yield();
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(tasks) / elapsed.count() / 1e6;
+}
+
+// 流水线的一个阶段: 切到工作线程上做约 1µs 的处理 (模拟 I/O 完成之后的回调)
+Task<int> Stage(ThreadPool& pool, int x) {
+    co_await pool.Schedule();
+    SpinFor(std::chrono::microseconds{1});
+    co_return x + 1;
+}
+
+Task<int> Pipeline(ThreadPool& pool, int stages) {
+    int x = 0;
+    for (int i = 0; i < stages; ++i) {
+        x = co_await Stage(pool, x);  // 等待期间不占用任何线程
+    }
+    co_return x;
+}
+
+Task<int> CountDown(int depth) {
+    if (depth == 0) {
+        co_return 0;
+    }
+    co_return 1 + co_await CountDown(depth - 1);
+}
+
+// pipelines 条流水线各走 stages 个阶段, 返回每秒完成的流水线数 (千)
+// kCoroutine 为 false 时是 future 版本: 每条流水线占用一个线程阻塞在 future.get() 上
+template <bool kCoroutine>
+double BenchPipelines(std::size_t threads, int pipelines, int stages) {
+    ThreadPool pool{threads};
+    auto start = std::chrono::steady_clock::now();
+    if constexpr (kCoroutine) {
+        std::vector<Task<int>> tasks;
+        for (int p = 0; p < pipelines; ++p) {
+            tasks.push_back(Pipeline(pool, stages));
+        }
+        for (int x : SyncWait(WhenAll(std::move(tasks)))) {
+            if (x != stages) {
+                std::cout << "pipeline mismatch" << std::endl;
+            }
+        }
+    } else {
+        std::vector<std::jthread> drivers;
+        for (int p = 0; p < pipelines; ++p) {
+            drivers.emplace_back([&pool, stages] {
+                int x = 0;
+                for (int i = 0; i < stages; ++i) {
+                    x = pool.Submit([x] {
+                                SpinFor(std::chrono::microseconds{1});
+                                return x + 1;
+                            }).get();
+                }
+            });
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(pipelines) / elapsed.count() / 1e3;
+}
+
+// 混合负载: 先灌入 kBacklog 个约 20µs 的批处理任务, 再每隔约 100µs 提交一个紧急任务,
+// 统计紧急任务从提交到开始执行的延迟 (µs); use_priority 为 false 时所有任务都走默认车道 FIFO
+std::pair<double, double> BenchMixedLoad(std::size_t threads, bool use_priority) {
+    constexpr int kBacklog = 4000;
+    constexpr int kUrgent = 200;
+    std::vector<double> latency_us(kUrgent);
+    std::atomic<int> urgent_done{0};
+    {
+        ThreadPool pool{threads};
+        auto batch = [] { SpinFor(std::chrono::microseconds{20}); };
+        for (int i = 0; i < kBacklog; ++i) {
+            if (use_priority) {
+                pool.Post(ThreadPool::Priority::kLow, batch);
+            } else {
+                pool.Post(batch);
+            }
+        }
+        for (int i = 0; i < kUrgent; ++i) {
+            auto submitted = std::chrono::steady_clock::now();
+            auto urgent = [&, i, submitted] {
+                std::chrono::duration<double, std::micro> d =
+                    std::chrono::steady_clock::now() - submitted;
+                latency_us[i] = d.count();
+                urgent_done.fetch_add(1, std::memory_order_release);
+            };
+            if (use_priority) {
+                pool.Post(ThreadPool::Priority::kHigh, urgent);
+            } else {
+                pool.Post(urgent);
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds{100});
+        }
+        while (urgent_done.load(std::memory_order_acquire) != kUrgent) {
+            std::this_thread::yield();
+        }
+    }
+    std::sort(latency_us.begin(), latency_us.end());
+    return {latency_us[kUrgent / 2], latency_us[kUrgent * 99 / 100]};
+}
+
+// 突发负载: 每轮从外部提交 kBurst 个空任务, 然后停顿 gap; 统计任务从提交到开始执行的延迟 (µs)
+// 对比立即睡眠 (spin_max = 0) 与自旋一段时间再睡眠
+std::pair<double, double> BenchBursty(std::size_t threads, std::chrono::microseconds spin_max,
+                                      std::chrono::microseconds gap) {
+    constexpr int kRounds = 500;
+    constexpr int kBurst = 4;
+    std::vector<double> latency_us(kRounds * kBurst);
+    std::atomic<int> done{0};
+    {
+        ThreadPool pool{threads, ThreadPoolOptions{.spin_max = spin_max}};
+        for (int r = 0; r < kRounds; ++r) {
+            for (int b = 0; b < kBurst; ++b) {
+                auto submitted = std::chrono::steady_clock::now();
+                pool.Post([&, slot = r * kBurst + b, submitted] {
+                    std::chrono::duration<double, std::micro> d =
+                        std::chrono::steady_clock::now() - submitted;
+                    latency_us[slot] = d.count();
+                    done.fetch_add(1, std::memory_order_release);
+                });
+            }
+            std::this_thread::sleep_for(gap);
+        }
+        while (done.load(std::memory_order_acquire) != kRounds * kBurst) {
+            std::this_thread::yield();
+        }
+    }
+    std::sort(latency_us.begin(), latency_us.end());
+    return {latency_us[latency_us.size() / 2], latency_us[latency_us.size() * 99 / 100]};
+}
+
+// 阻塞型负载: 外部一次提交 kTasks 个各睡 1ms 的任务 (模拟等 IO), 返回全部完成的耗时 (ms)
+// 和期间观察到的最大线程数; 固定线程数的池要么线程不够, 要么平时白白占着线程
+std::pair<double, std::size_t> BenchBlocking(std::size_t threads, ThreadPoolOptions options) {
+    constexpr int kTasks = 256;
+    std::atomic<int> remaining{kTasks};
+    std::size_t peak = 0;
+    ThreadPool pool{threads, options};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTasks; ++i) {
+        pool.Post([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            remaining.fetch_sub(1, std::memory_order_release);
+        });
+    }
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        peak = std::max(peak, pool.Size());
+        std::this_thread::sleep_for(std::chrono::microseconds{100});
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return {elapsed.count(), std::max(peak, pool.Size())};
+}
+
+// 可观测性的开销: 同 BenchFineGrained 的 Post 场景 (空任务)
+// 比较只开计数器、再开计时、再挂 trace 钩子
+double BenchObserved(std::size_t threads, std::size_t total_tasks, ThreadPoolOptions options) {
+    constexpr std::size_t kSpawners = 64;
+    const std::size_t per_spawner = total_tasks / kSpawners;
+    std::atomic<std::size_t> remaining{per_spawner * kSpawners};
+    std::promise<void> done;
+
+    ThreadPool pool{threads, std::move(options)};
+    auto leaf = [&] {
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            done.set_value();
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t s = 0; s < kSpawners; ++s) {
+        pool.Post([&] {
+            for (std::size_t i = 0; i < per_spawner; ++i) {
+                pool.Post(leaf);
+            }
+        });
+    }
+    done.get_future().wait();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(per_spawner * kSpawners) / elapsed.count() / 1e6;
+}
+
+int main() {
+    std::cout << "--- Submit / future ---" << std::endl;
+    {
+        ThreadPool pool{4};
+        auto sum = pool.Submit([](int a, int b) { return a + b; }, 1, 2);
+        auto failed = pool.Submit([] { throw std::runtime_error("boom"); });
+        // 工作线程内部提交的任务进入本地队列, 其他线程可以窃取
+        auto nested = pool.Submit([&pool] { return pool.Submit([] { return 42; }); });
+        std::cout << "1 + 2 = " << sum.get() << std::endl;
+        try {
+            failed.get();
+        } catch (const std::exception& e) {
+            std::cout << "exception: " << e.what() << std::endl;
+        }
+        std::cout << "nested = " << nested.get().get() << std::endl;
+    }
+
+    std::cout << "\n--- SubmitBatch / ParallelFor / ParallelReduce ---" << std::endl;
+    {
+        ThreadPool pool{4};
+        std::vector<std::function<void()>> batch;
+        std::atomic<int> ran{0};
+        for (int i = 0; i < 8; ++i) {
+            batch.emplace_back([&ran, i] {
+                ran.fetch_add(1);
+                if (i == 3) {
+                    throw std::runtime_error("task 3 failed");
+                }
+            });
+        }
+        try {
+            pool.SubmitBatch(batch).get();
+        } catch (const std::exception& e) {
+            std::cout << "batch ran " << ran.load() << " tasks, exception: " << e.what()
+                      << std::endl;
+        }
+
+        // 工作线程内部提交一批超过本地队列初始容量(256)的任务: 队列先一次性扩容再逐个压入
+        std::atomic<int> nested{0};
+        pool.Submit([&] {
+                std::vector<std::function<void()>> inner(1000, [&nested] { nested.fetch_add(1); });
+                pool.SubmitBatch(inner).get();
+            })
+            .get();
+        std::cout << "nested batch from a worker ran " << nested.load() << " tasks" << std::endl;
+
+        std::vector<int> squares(1000);
+        pool.ParallelFor(0, 1000, 64, [&](int i) { squares[i] = i * i; });
+        long long sum = pool.ParallelReduce(
+            0, 1000, 64, 0LL, [&](int i) { return static_cast<long long>(squares[i]); },
+            std::plus<>{});
+        std::cout << "sum of squares [0, 1000) = " << sum << std::endl;
+
+        Matrix a = MakeMatrix(64, 1);
+        Matrix b = MakeMatrix(64, 2);
+        std::cout << "Multiply = " << Multiply(a, b)
+                  << ", ParallelMultiply = " << ParallelMultiply(pool, a, b) << std::endl;
+    }
+
+    std::cout << "\n--- Task<T> / co_await pool.Schedule() ---" << std::endl;
+    {
+        ThreadPool pool{4};
+        auto add = [&pool](int a, int b) -> Task<int> {
+            co_await pool.Schedule();
+            co_return a + b;
+        };
+        auto fail = [&pool]() -> Task<void> {
+            co_await pool.Schedule();
+            throw std::runtime_error("coroutine failed");
+        };
+        std::cout << "add = " << SyncWait(add(20, 22)) << std::endl;
+        try {
+            SyncWait(fail());
+        } catch (const std::exception& e) {
+            std::cout << "exception: " << e.what() << std::endl;
+        }
+        Task<int> moved_from = add(1, 2);
+        Task<int> owner = std::move(moved_from);
+        try {
+            SyncWait(std::move(moved_from));
+        } catch (const std::logic_error& e) {
+            std::cout << "exception: " << e.what() << ", owner still yields "
+                      << SyncWait(std::move(owner)) << std::endl;
+        }
+        // 对称转移: 深层 co_await 链逐层切换协程帧, 不会层层嵌套 resume()
+        std::cout << "CountDown(10000) = " << SyncWait(CountDown(10'000)) << std::endl;
+        std::vector<Task<int>> stages;
+        for (int i = 0; i < 4; ++i) {
+            stages.push_back(Pipeline(pool, i + 1));
+        }
+        std::cout << "WhenAll =";
+        for (int x : SyncWait(WhenAll(std::move(stages)))) {
+            std::cout << " " << x;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "\n--- Priority lanes / deadlines ---" << std::endl;
+    {
+        ThreadPool pool{1};
+        std::promise<void> gate;
+        std::shared_future<void> opened = gate.get_future().share();
+        pool.Post([opened] { opened.wait(); });  // 先堵住唯一的工作线程
+        std::mutex order_mtx;
+        std::vector<std::string> order;
+        auto record = [&](std::string name) {
+            return [&, name] {
+                std::lock_guard lk{order_mtx};
+                order.push_back(name);
+            };
+        };
+        auto now = ThreadPool::Clock::now();
+        pool.Post(ThreadPool::Priority::kLow, record("low"));
+        pool.Post(record("normal"));
+        for (int ms : {30, 10, 20}) {
+            pool.Post(ThreadPool::Priority::kHigh, now + std::chrono::milliseconds{ms},
+                      record("high+" + std::to_string(ms) + "ms"));
+        }
+        gate.set_value();
+        pool.Submit(ThreadPool::Priority::kLow, [] {}).wait();  // 排在低车道末尾, 等前面的都执行完
+        std::cout << "order:";
+        for (const auto& name : order) {
+            std::cout << " " << name;
+        }
+        std::cout << std::endl;
+        auto high = pool.GetLaneStats(ThreadPool::Priority::kHigh);
+        std::cout << "high lane: dispatched " << high.dispatched << ", max wait "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(high.max_wait).count()
+                  << "us, deadline misses " << high.deadline_misses << std::endl;
+    }
+
+    std::cout << "\n--- Elastic workers / CPU topology ---" << std::endl;
+    {
+        const CpuTopology& topology = CpuTopology::Get();
+        for (std::size_t node = 0; node < topology.NodeCount(); ++node) {
+            std::cout << "node " << node << ":";
+            for (int cpu : topology.NodeCpus(node)) {
+                std::cout << " " << cpu;
+            }
+            std::cout << std::endl;
+        }
+        std::cout << "caller runs on node " << topology.CurrentNode() << std::endl;
+
+        ThreadPool pool{2, ThreadPoolOptions{.max_threads = 8,
+                                             .idle_timeout = std::chrono::milliseconds{50},
+                                             .affinity = CpuAffinity::kCore}};
+        std::cout << "idle: " << pool.Size() << " threads (min " << pool.MinSize() << ", max "
+                  << pool.MaxSize() << ")" << std::endl;
+        std::promise<void> gate;
+        std::shared_future<void> opened = gate.get_future().share();
+        std::vector<std::future<void>> blocked;
+        for (int i = 0; i < 16; ++i) {
+            blocked.push_back(pool.Submit([opened] { opened.wait(); }));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        std::cout << "16 blocked tasks: " << pool.Size() << " threads" << std::endl;
+        gate.set_value();
+        for (auto& f : blocked) {
+            f.get();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{200});
+        std::cout << "after idle_timeout: " << pool.Size() << " threads" << std::endl;
+    }
+
+    std::cout << "\n--- Metrics / Chrome trace ---" << std::endl;
+    {
+        ChromeTraceWriter trace;
+        {
+            ThreadPool pool{4, ThreadPoolOptions{.on_task_end = trace.Hook()}};
+            // 一个 20ms 的长任务, 后面跟 200 个 50us 的短任务: 排在长任务后面的短任务会等很久
+            std::vector<std::future<void>> done;
+            done.push_back(pool.Submit([] { SpinFor(std::chrono::milliseconds{20}); }));
+            for (int i = 0; i < 200; ++i) {
+                done.push_back(pool.Submit([] { SpinFor(std::chrono::microseconds{50}); }));
+            }
+            for (auto& f : done) {
+                f.get();
+            }
+            pool.Shutdown();  // future 就绪时任务还没返回, 等工作线程把最后几个任务记完
+            auto us = [](std::chrono::nanoseconds d) {
+                return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+            };
+            ThreadPool::Metrics m = pool.GetMetrics();
+            std::cout << "worker\ttasks\tlocal\tstolen\tlanes\tparks\tbusy us" << std::endl;
+            for (std::size_t i = 0; i < m.workers.size(); ++i) {
+                const auto& w = m.workers[i];
+                std::cout << i << "\t" << w.tasks << "\t" << w.local << "\t" << w.stolen << "\t"
+                          << w.from_lanes << "\t" << w.parks << "\t" << us(w.busy) << std::endl;
+            }
+            std::cout << "queue latency p50 <= " << us(m.queue_latency.Percentile(0.5))
+                      << "us, p99 <= " << us(m.queue_latency.Percentile(0.99))
+                      << "us; run time p50 <= " << us(m.run_time.Percentile(0.5))
+                      << "us; utilization " << m.Utilization() << std::endl;
+        }
+        std::ofstream file{"thread_pool_trace.json"};
+        trace.Write(file);
+        std::cout << "wrote " << trace.Size() << " events to thread_pool_trace.json" << std::endl;
+    }
+
+    constexpr std::size_t kTasks = 1'000'000;
+    std::cout << "\n--- Benchmark: 1M x ~1us tasks, Mtasks/s ---" << std::endl;
+    RunFineGrained(kTasks, std::chrono::microseconds{1});
+    std::cout << "\n--- Benchmark: 1M empty tasks, Mtasks/s ---" << std::endl;
+    RunFineGrained(kTasks, std::chrono::nanoseconds{0});
+
+    std::cout << "\n--- Benchmark: 1M empty Post tasks with observability, Mtasks/s ---"
+              << std::endl;
+    std::cout << "threads\tcounters\t+timing\t\t+trace hook" << std::endl;
+    for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+        double counters = BenchObserved(threads, kTasks, {});
+        double timing = BenchObserved(threads, kTasks, ThreadPoolOptions{.collect_timing = true});
+        ChromeTraceWriter trace{kTasks * threads, threads};  // 每个工作线程一片, 不丢事件
+        double traced =
+            BenchObserved(threads, kTasks, ThreadPoolOptions{.on_task_end = trace.Hook()});
+        std::cout << threads << "\t" << counters << "\t\t" << timing << "\t\t" << traced
+                  << std::endl;
+    }
+
+    std::cout << "\n--- Benchmark: 100k empty tasks from outside, Mtasks/s ---" << std::endl;
+    std::cout << "threads\tPost loop\tSubmitBatch" << std::endl;
+    for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+        double post = BenchExternalSubmit(threads, 100'000, false);
+        double batch = BenchExternalSubmit(threads, 100'000, true);
+        std::cout << threads << "\t" << post << "\t\t" << batch << std::endl;
+    }
+
+    std::cout << "\n--- Benchmark: 256 pipelines x 8 stages, Kpipelines/s ---" << std::endl;
+    std::cout << "threads\tfuture.get()\tco_await" << std::endl;
+    for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+        double futures = BenchPipelines<false>(threads, 256, 8);
+        double coroutines = BenchPipelines<true>(threads, 256, 8);
+        std::cout << threads << "\t" << futures << "\t\t" << coroutines << std::endl;
+    }
+
+    std::cout << "\n--- Benchmark: urgent task latency under 4000 x 20us backlog, us ---"
+              << std::endl;
+    std::cout << "threads\tFIFO p50\tFIFO p99\tlanes p50\tlanes p99" << std::endl;
+    for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+        auto [fifo_p50, fifo_p99] = BenchMixedLoad(threads, false);
+        auto [lane_p50, lane_p99] = BenchMixedLoad(threads, true);
+        std::cout << threads << "\t" << fifo_p50 << "\t\t" << fifo_p99 << "\t\t" << lane_p50
+                  << "\t\t" << lane_p99 << std::endl;
+    }
+
+    std::cout << "\n--- Benchmark: bursty wakeup latency (4 tasks / 20us gap), us ---" << std::endl;
+    std::cout << "threads\tpark p50\tpark p99\tspin p50\tspin p99" << std::endl;
+    for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+        auto [park_p50, park_p99] =
+            BenchBursty(threads, std::chrono::microseconds{0}, std::chrono::microseconds{20});
+        auto [spin_p50, spin_p99] =
+            BenchBursty(threads, std::chrono::microseconds{200}, std::chrono::microseconds{20});
+        std::cout << threads << "\t" << park_p50 << "\t\t" << park_p99 << "\t\t" << spin_p50
+                  << "\t\t" << spin_p99 << std::endl;
+    }
+
+    std::cout << "\n--- Benchmark: 256 x 1ms blocking tasks, ms (peak threads) ---" << std::endl;
+    std::cout << "min\tfixed min\telastic min..64\tfixed 64" << std::endl;
+    for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+        auto [fixed_ms, fixed_peak] = BenchBlocking(threads, {});
+        auto [elastic_ms, elastic_peak] =
+            BenchBlocking(threads, ThreadPoolOptions{.max_threads = 64});
+        auto [max_ms, max_peak] = BenchBlocking(64, {});
+        std::cout << threads << "\t" << fixed_ms << " (" << fixed_peak << ")\t" << elastic_ms
+                  << " (" << elastic_peak << ")\t" << max_ms << " (" << max_peak << ")"
+                  << std::endl;
+    }
+
+    std::cout << "\n--- Benchmark: 256x256 matrix multiply, ms ---" << std::endl;
+    {
+        Matrix a = MakeMatrix(256, 1);
+        Matrix b = MakeMatrix(256, 2);
+        auto start = std::chrono::steady_clock::now();
+        int64_t expect = Multiply(a, b);
+        std::chrono::duration<double, std::milli> serial = std::chrono::steady_clock::now() - start;
+        std::cout << "serial\t" << serial.count() << std::endl;
+        std::cout << "threads\tunpinned\tper core\tper node" << std::endl;
+        for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+            std::cout << threads;
+            for (CpuAffinity affinity :
+                 {CpuAffinity::kNone, CpuAffinity::kCore, CpuAffinity::kNumaNode}) {
+                ThreadPool pool{threads, ThreadPoolOptions{.affinity = affinity}};
+                start = std::chrono::steady_clock::now();
+                int64_t got = ParallelMultiply(pool, a, b);
+                std::chrono::duration<double, std::milli> ms =
+                    std::chrono::steady_clock::now() - start;
+                std::cout << "\t" << ms.count() << (got == expect ? "" : " MISMATCH") << "\t";
+            }
+            std::cout << std::endl;
+        }
+    }
+    return 0;
+}
@@ -1,21 +1,168 @@
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <optional>
+#include <ranges>
 #include <thread>
 #include <vector>
 
-template <typename T>
+// 固定大小内存块的回收缓存: 每个线程一个小缓存, 空了从全局仓库整批取, 满了把一半整批还回去
+// NOTE: 生产者线程分配、消费者线程释放时, 块经由仓库流回生产者; 稳态下不再调用 operator new,
+// 仓库的锁每 kBatchSize 次分配/释放才碰一次
+// NOTE: 全局的 LockFreeStack 在 main 返回后才析构, 此时主线程的 thread_local 缓存已经析构,
+// 仓库这个函数内静态对象也可能先走一步. 所以仓库永不析构,
+// 缓存析构后的块直接交给 operator new/delete
+// 所有 BlockCache 向上游(operator new)申请过的块数, 用来观察稳态下是否还在分配
+inline std::atomic<uint64_t> g_block_cache_upstream{0};
+
+template <std::size_t kSize, std::size_t kAlign>
+class BlockCache {
+public:
+    static void* Allocate() {
+        if (LocalDestroyed()) {
+            g_block_cache_upstream.fetch_add(1, std::memory_order_relaxed);
+            return ::operator new(kSize, std::align_val_t{kAlign});
+        }
+        auto& local = Local();
+        if (local.blocks.empty()) {
+            Instance().Refill(local.blocks);
+        }
+        void* p = local.blocks.back();
+        local.blocks.pop_back();
+        return p;
+    }
+
+    static void Deallocate(void* p) noexcept {
+        if (LocalDestroyed()) {
+            ::operator delete(p, std::align_val_t{kAlign});
+            return;
+        }
+        auto& local = Local();
+        if (local.blocks.size() >= 2 * kBatchSize) {
+            Instance().Flush(local.blocks, kBatchSize);
+        }
+        local.blocks.push_back(p);  // NOTE: capacity 已预留 2 * kBatchSize, 不会分配
+    }
+
+private:
+    static constexpr std::size_t kBatchSize = 64;
+
+    struct LocalCache {
+        LocalCache() { blocks.reserve(2 * kBatchSize); }
+        ~LocalCache() {
+            Instance().Flush(blocks, blocks.size());  // 线程退出时全部还给仓库
+            LocalDestroyed() = true;
+        }
+        std::vector<void*> blocks;
+    };
+
+    // 故意泄漏: 比任何静态对象和 thread_local 都活得久, 进程退出时由操作系统回收
+    static BlockCache& Instance() {
+        static auto* instance = new BlockCache;
+        return *instance;
+    }
+
+    // 本线程的 LocalCache 是否已经析构; bool 没有析构函数, 之后仍然可以读
+    static bool& LocalDestroyed() noexcept {
+        thread_local bool destroyed = false;
+        return destroyed;
+    }
+
+    static LocalCache& Local() {
+        static thread_local LocalCache cache;
+        return cache;
+    }
+
+    void Refill(std::vector<void*>& out) {
+        {
+            std::lock_guard lk{mtx_};
+            std::size_t n = std::min(kBatchSize, depot_.size());
+            out.insert(out.end(), depot_.end() - static_cast<std::ptrdiff_t>(n), depot_.end());
+            depot_.resize(depot_.size() - n);
+        }
+        if (out.size() < kBatchSize) {
+            g_block_cache_upstream.fetch_add(kBatchSize - out.size(), std::memory_order_relaxed);
+        }
+        while (out.size() < kBatchSize) {
+            out.push_back(::operator new(kSize, std::align_val_t{kAlign}));
+        }
+    }
+
+    void Flush(std::vector<void*>& from, std::size_t n) noexcept {
+        std::lock_guard lk{mtx_};
+        // NOTE: depot_ 扩容抛 bad_alloc 时, 这一批块就地还给 operator delete
+        try {
+            depot_.insert(depot_.end(), from.end() - static_cast<std::ptrdiff_t>(n), from.end());
+        } catch (...) {
+            for (auto it = from.end() - static_cast<std::ptrdiff_t>(n); it != from.end(); ++it) {
+                ::operator delete(*it, std::align_val_t{kAlign});
+            }
+        }
+        from.resize(from.size() - n);
+    }
+
+    std::mutex mtx_;
+    std::vector<void*> depot_;
+};
+
+// 给 std::allocate_shared 用的分配器: 单个对象走 BlockCache, 数组照常走 std::allocator
+// NOTE: allocate_shared 会把它 rebind 到「控制块 + Node」的内部类型, 节点和引用计数一起被回收
+template <typename U>
+struct RecyclingAllocator {
+    using value_type = U;
+
+    RecyclingAllocator() noexcept = default;
+    template <typename V>
+    RecyclingAllocator(const RecyclingAllocator<V>&) noexcept {}  // NOLINT: rebind 需要隐式转换
+
+    U* allocate(std::size_t n) {
+        if (n != 1) {
+            return std::allocator<U>{}.allocate(n);
+        }
+        return static_cast<U*>(BlockCache<sizeof(U), alignof(U)>::Allocate());
+    }
+
+    void deallocate(U* p, std::size_t n) noexcept {
+        if (n != 1) {
+            std::allocator<U>{}.deallocate(p, n);
+            return;
+        }
+        BlockCache<sizeof(U), alignof(U)>::Deallocate(p);
+    }
+
+    template <typename V>
+    bool operator==(const RecyclingAllocator<V>&) const noexcept {
+        return true;
+    }
+};
+
+// Allocator 决定节点(连同 shared_ptr 控制块)从哪里分配: 默认回收复用, std::allocator<T> 即原来的
+// make_shared 行为
+template <typename T, typename Allocator = RecyclingAllocator<T>>
 class LockFreeStack {
 public:
     LockFreeStack() = default;
-    ~LockFreeStack() = default;
+    ~LockFreeStack() {
+        // NOTE: 默认析构会经由 next_ 递归析构整条链, 链很长时会爆栈; 这里逐个往后挪,
+        // 每一步先持有下一个节点再放掉当前节点, 析构深度始终是 1
+        auto node{head_.exchange(nullptr, std::memory_order_acquire)};
+        while (node) {
+            node = node->next_;
+        }
+    }
     LockFreeStack(LockFreeStack const&) = delete;
     LockFreeStack(LockFreeStack&&) = delete;
 
 public:
     void Push(T data) {
-        auto new_node{std::make_shared<Node>(std::move(data))};
+        auto new_node{MakeNode(std::move(data))};
         new_node->next_ = head_.load(std::memory_order_acquire);
         // NOTE: 当前值: new_node->next_
         // Push CAS 成功: release语义, 需要把 new_node 写入 head
@@ -40,11 +187,83 @@ public:
         }
         // NOTE: 判断空链表
         if (old_head) {
-            return old_head->data_;  // 读取节点内容
+            // NOTE: CAS 成功后只有本线程会碰 data_ (其他线程手里的旧 old_head 只读 next_),
+            // 可以直接移走而不是拷贝
+            return std::move(old_head->data_);
         }
         return std::nullopt;
     }
 
+    // 批量压入: 先在本地把整个 range 串成一条链, 再用一次 CAS 把链挂到栈顶
+    // 链上的顺序与 range 相反, 即 range 的最后一个元素成为栈顶 (与逐个 Push 的结果一致)
+    // 返回压入的元素个数
+    template <std::ranges::input_range R>
+        requires std::constructible_from<T, std::ranges::range_reference_t<R>>
+    std::size_t PushRange(R&& range) {
+        std::shared_ptr<Node> first;  // 链上最后压入的, 将成为栈顶
+        Node* last = nullptr;         // 链上最先压入的, 它的 next_ 接旧栈顶
+        std::size_t count = 0;
+        for (auto&& value : range) {
+            auto node{MakeNode(T(std::forward<decltype(value)>(value)))};
+            node->next_ = std::move(first);
+            if (last == nullptr) {
+                last = node.get();
+            }
+            first = std::move(node);
+            ++count;
+        }
+        if (count == 0) {
+            return 0;
+        }
+        // NOTE: 链还没发布, 其他线程看不到, 只有 last->next_ 需要随 CAS 失败而更新
+        last->next_ = head_.load(std::memory_order_acquire);
+        while (!head_.compare_exchange_weak(last->next_, first, std::memory_order_release,
+                                            std::memory_order_acquire)) {
+        }
+        return count;
+    }
+
+    // 一次 exchange 摘下整个栈, 按出栈顺序(栈顶在前)返回
+    std::vector<T> PopAll() {
+        std::vector<T> out;
+        auto node{head_.exchange(nullptr, std::memory_order_acq_rel)};
+        // NOTE: 摘下的链上的节点可能仍被其他 Pop 的旧 old_head 引用着, 它们会读 next_,
+        // 所以这里只读 next_ 不改它; 先持有下一个再放掉当前, 避免递归析构
+        while (node) {
+            out.push_back(std::move(node->data_));
+            node = node->next_;
+        }
+        return out;
+    }
+
+    // 一次 CAS 摘下栈顶的至多 n 个元素, 按出栈顺序返回
+    std::vector<T> PopN(std::size_t n) {
+        std::vector<T> out;
+        if (n == 0) {
+            return out;
+        }
+        auto old_head{head_.load(std::memory_order_acquire)};
+        std::shared_ptr<Node> rest;
+        while (old_head) {
+            // old_head 持有整条链, 沿链数 n 个节点是安全的 (链上的节点都不会被释放)
+            Node* tail = old_head.get();
+            for (std::size_t i = 1; i < n && tail->next_; ++i) {
+                tail = tail->next_.get();
+            }
+            rest = tail->next_;
+            if (head_.compare_exchange_weak(old_head, rest, std::memory_order_acq_rel,
+                                            std::memory_order_acquire)) {
+                break;
+            }
+        }
+        auto node{std::move(old_head)};
+        while (node != rest) {
+            out.push_back(std::move(node->data_));
+            node = node->next_;
+        }
+        return out;
+    }
+
 private:
     // 内部定义
     struct Node {
@@ -55,10 +274,57 @@ private:
         explicit Node(T data) : data_(std::move(data)) {}
     };
 
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+
+    static std::shared_ptr<Node> MakeNode(T data) {
+        return std::allocate_shared<Node>(NodeAllocator{}, std::move(data));
+    }
+
 private:
     std::atomic<std::shared_ptr<Node>> head_;
 };
 
+// --- 基准测试 ---
+
+constexpr int kBatch = 64;
+
+template <typename Run>
+double MeasureMops(int threads, int ops_per_thread, Run run) {
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::vector<std::jthread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back(run);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(threads) * ops_per_thread / elapsed.count() / 1e6;
+}
+
+// 每个线程交替 Push / Pop, 一次 Push + 一次 Pop 记 2 次操作
+template <typename Allocator>
+double BenchPushPop(int threads, int ops_per_thread) {
+    LockFreeStack<int, Allocator> stack;
+    return MeasureMops(threads, ops_per_thread, [&stack, ops_per_thread] {
+        for (int i = 0; i < ops_per_thread / 2; ++i) {
+            stack.Push(i);
+            stack.Pop();
+        }
+    });
+}
+
+// 每个线程 PushRange 一批再 PopN 一批, 每个元素记 2 次操作
+double BenchBatched(int threads, int ops_per_thread) {
+    LockFreeStack<int> stack;
+    return MeasureMops(threads, ops_per_thread, [&stack, ops_per_thread] {
+        std::vector<int> batch(kBatch);
+        for (int i = 0; i < ops_per_thread / (2 * kBatch); ++i) {
+            stack.PushRange(batch);
+            stack.PopN(kBatch);
+        }
+    });
+}
+
 int main() {
     LockFreeStack<int> stack;
     std::atomic<int> sum_popped = 0;
@@ -68,35 +334,38 @@ int main() {
     const int kConsumerCount = 4;
     const int kTotalItems = kItemsPerProducer * kProducerCount;
 
-    std::vector<std::jthread> producers;
-    for (int i = 0; i < kProducerCount; ++i) {
-        producers.emplace_back([&stack, i] {
-            for (int j = 0; j < kItemsPerProducer; ++j) {
-                // 每个生产者产生不同的数字范围，以确保数据唯一
-                stack.Push(i * kItemsPerProducer + j);
-            }
-        });
-    }
-
-    std::vector<std::jthread> consumers;
-    for (int i = 0; i < kConsumerCount; ++i) {
-        consumers.emplace_back([&stack, &sum_popped, &pop_count] {
-            while (pop_count.load() < kTotalItems) {
-                auto value = stack.Pop();
-                if (value.has_value()) {
-                    sum_popped += *value;
-                    pop_count++;
+    // NOTE: 放进块作用域, 保证打印结果前所有线程都已 join
+    {
+        std::vector<std::jthread> producers;
+        for (int i = 0; i < kProducerCount; ++i) {
+            producers.emplace_back([&stack, i] {
+                for (int j = 0; j < kItemsPerProducer; ++j) {
+                    // 每个生产者产生不同的数字范围，以确保数据唯一
+                    stack.Push(i * kItemsPerProducer + j);
                 }
-                // 在没有取到值时稍微让出CPU，避免空转
-                // 在高竞争下这是一种常见的策略
-                else {
-                    std::this_thread::yield();
+            });
+        }
+
+        std::vector<std::jthread> consumers;
+        for (int i = 0; i < kConsumerCount; ++i) {
+            consumers.emplace_back([&stack, &sum_popped, &pop_count] {
+                while (pop_count.load() < kTotalItems) {
+                    auto value = stack.Pop();
+                    if (value.has_value()) {
+                        sum_popped += *value;
+                        pop_count++;
+                    }
+                    // 在没有取到值时稍微让出CPU，避免空转
+                    // 在高竞争下这是一种常见的策略
+                    else {
+                        std::this_thread::yield();
+                    }
                 }
-            }
-        });
-    }
+            });
+        }
 
-    // producers 和 consumers 的 jthread 会在析构时自动 join
+        // producers 和 consumers 的 jthread 会在析构时自动 join
+    }
 
     std::cout << "所有生产者和消费者线程已完成。\n";
     std::cout << "总共压入的元素数量: " << kTotalItems << "\n";
@@ -113,5 +382,41 @@ int main() {
         std::cout << "测试失败！\n";
     }
 
+    std::cout << "\n--- PushRange / PopN / PopAll ---\n";
+    {
+        LockFreeStack<std::unique_ptr<int>> batch;  // 只能移动的类型也能出栈
+        std::vector<std::unique_ptr<int>> values;
+        for (int i = 0; i < 10; ++i) {
+            values.push_back(std::make_unique<int>(i));
+        }
+        auto moved = std::ranges::subrange(std::make_move_iterator(values.begin()),
+                                           std::make_move_iterator(values.end()));
+        std::cout << "PushRange: " << batch.PushRange(moved) << "\n";
+        std::cout << "PopN(3):";
+        for (const auto& v : batch.PopN(3)) {
+            std::cout << ' ' << *v;
+        }
+        std::cout << "\nPop: " << **batch.Pop() << "\nPopAll:";
+        for (const auto& v : batch.PopAll()) {
+            std::cout << ' ' << *v;
+        }
+        std::cout << "\nPop after PopAll: " << (batch.Pop() ? "value" : "empty") << "\n";
+    }
+
+    constexpr int kOps = 100'000;
+    std::cout << "\n--- Benchmark: push/pop pairs, Mops/s (" << kOps
+              << " ops per thread) ---\n";
+    std::cout << "threads\tmake_shared\trecycling\tPushRange+PopN(" << kBatch << ")\n";
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        std::cout << threads << '\t' << BenchPushPop<std::allocator<int>>(threads, kOps) << "\t\t"
+                  << BenchPushPop<RecyclingAllocator<int>>(threads, kOps) << "\t\t"
+                  << BenchBatched(threads, kOps) << "\n";
+    }
+
+    // 上面的线程退出时已把缓存还给仓库, 再跑一轮应当不再向上游申请
+    uint64_t before = g_block_cache_upstream.load();
+    BenchPushPop<RecyclingAllocator<int>>(8, kOps);
+    std::cout << "\nupstream blocks: " << before << " total, "
+              << g_block_cache_upstream.load() - before << " in a steady-state rerun\n";
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// 基于风险指针(hazard pointer)回收内存的无锁栈
+// lockfree_stack.cpp 和 lockfree_stack_cpp17.cpp 用 shared_ptr 的引用计数保证「正在被别人读的
+// 节点不会被释放」, 但 libstdc++ 的 atomic<shared_ptr> 和 std::atomic_load(&shared_ptr) 都是
+// 用内部的自旋锁表实现的 (is_lock_free() 为 false), 每次 Push/Pop 还有好几次引用计数的原子 RMW
+// 这里节点用裸指针, head_ 是真正无锁的 std::atomic<Node*>, 释放节点交给风险指针:
+//   * 读者要解引用一个共享节点之前, 先把它的地址登记到自己的风险指针槽位里
+//   * 摘下节点的线程不立刻 delete, 而是放进本线程的待回收列表(retire)
+//   * 待回收列表攒够一定数量后扫描一遍所有槽位, 没被任何槽位登记的节点才真正 delete
+// NOTE: 风险指针同时解决了 ABA: 被登记的节点不会被释放, 它的地址也就不会被复用后重新入栈
+
+// 风险指针槽位的全局登记表 (进程内一个)
+// NOTE: 槽位只增不减, 线程退出时把槽位标记为空闲, 留给之后的线程复用
+class HazardPointerDomain {
+public:
+    static constexpr std::size_t kMaxRecords = 256;
+
+    // 一个槽位, 独占缓存行: 读者频繁写自己的槽位, 不能和别人的槽位伪共享
+    struct alignas(64) Record {
+        std::atomic<const void*> pointer{nullptr};
+        std::atomic<bool> active{false};
+    };
+
+    static HazardPointerDomain& Global() {
+        static HazardPointerDomain domain;
+        return domain;
+    }
+
+    ~HazardPointerDomain() {
+        // 进程退出时所有线程都已结束, 孤儿节点不可能再被登记
+        for (const Retired& r : orphans_) {
+            r.deleter(r.pointer);
+        }
+    }
+
+    // 占用编号最小的空闲槽位, 必要时抬高高水位; 每个线程只在第一次用风险指针时走到这里
+    Record* AcquireRecord() {
+        for (std::size_t i = 0; i < kMaxRecords; ++i) {
+            bool expected = false;
+            if (!records_[i].active.load(std::memory_order_relaxed) &&
+                records_[i].active.compare_exchange_strong(expected, true,
+                                                           std::memory_order_acquire)) {
+                // NOTE: 先抬高水位再使用槽位, 扫描线程读到的高水位一定覆盖所有已登记的槽位
+                std::size_t used = used_.load(std::memory_order_relaxed);
+                while (used <= i && !used_.compare_exchange_weak(used, i + 1)) {
+                }
+                return &records_[i];
+            }
+        }
+        throw std::runtime_error("HazardPointerDomain: too many hazard pointers");
+    }
+
+    void ReleaseRecord(Record* record) noexcept {
+        record->pointer.store(nullptr, std::memory_order_release);
+        record->active.store(false, std::memory_order_release);
+    }
+
+    // 待回收的节点: 类型擦除的删除函数, 一个 domain 可以服务任意节点类型
+    struct Retired {
+        void* pointer;
+        void (*deleter)(void*);
+    };
+
+    template <typename T>
+    void Retire(T* p) {
+        auto& list = LocalRetired().list;
+        list.push_back({p, [](void* q) { delete static_cast<T*>(q); }});
+        // NOTE: 阈值跟槽位数成正比, 每次扫描至少能释放一半, 摊还下来每个节点 O(1)
+        if (list.size() >= 2 * used_.load(std::memory_order_relaxed) + 64) {
+            Scan(list);
+        }
+    }
+
+    // 把 list 中没被任何槽位登记的节点释放掉, 其余的留在 list 里等下次
+    void Scan(std::vector<Retired>& list) {
+        {
+            // 顺便收养已退出线程留下的节点
+            std::lock_guard lk{orphans_mtx_};
+            list.insert(list.end(), orphans_.begin(), orphans_.end());
+            orphans_.clear();
+        }
+        std::vector<const void*> hazards;
+        const std::size_t used = used_.load(std::memory_order_seq_cst);
+        hazards.reserve(used);
+        for (std::size_t i = 0; i < used; ++i) {
+            // NOTE: acquire 与读者清除登记时的 release 配对: 读者对节点的访问先于这里的 delete
+            if (const void* p = records_[i].pointer.load(std::memory_order_seq_cst)) {
+                hazards.push_back(p);
+            }
+        }
+        std::sort(hazards.begin(), hazards.end());
+        auto keep = std::partition(list.begin(), list.end(), [&](const Retired& r) {
+            return std::binary_search(hazards.begin(), hazards.end(), r.pointer);
+        });
+        // NOTE: 先移出 list 再删除: 节点里的 T 析构时可能又 Retire 别的节点, 往 list 里追加
+        std::vector<Retired> reclaim(keep, list.end());
+        list.erase(keep, list.end());
+        for (const Retired& r : reclaim) {
+            r.deleter(r.pointer);
+        }
+    }
+
+private:
+    HazardPointerDomain() = default;
+
+    // 每个线程的待回收列表; 线程退出时能释放的释放, 剩下的交给 domain 当孤儿
+    struct RetiredList {
+        std::vector<Retired> list;
+        ~RetiredList() {
+            HazardPointerDomain& domain = Global();
+            domain.Scan(list);
+            std::lock_guard lk{domain.orphans_mtx_};
+            domain.orphans_.insert(domain.orphans_.end(), list.begin(), list.end());
+        }
+    };
+
+    static RetiredList& LocalRetired() {
+        static thread_local RetiredList retired;
+        return retired;
+    }
+
+    Record records_[kMaxRecords];
+    std::atomic<std::size_t> used_{0};  // 用过的槽位高水位 (只增不减)
+    std::mutex orphans_mtx_;
+    std::vector<Retired> orphans_;
+};
+
+// 一个风险指针 (RAII): 构造时从本线程的缓存里取一个槽位, 析构时还回去
+// NOTE: 槽位缓存在线程本地, 稳态下构造/析构不碰任何共享变量
+class HazardPointer {
+public:
+    HazardPointer() : record_(Cache().Take()) {}
+    ~HazardPointer() {
+        record_->pointer.store(nullptr, std::memory_order_release);
+        Cache().Give(record_);
+    }
+
+    HazardPointer(const HazardPointer&) = delete;
+    HazardPointer& operator=(const HazardPointer&) = delete;
+
+    // 登记 src 当前指向的节点并返回它; 返回后只要不 Reset, 这个节点就不会被释放
+    // NOTE: 登记之后必须重新读一次 src 确认节点还挂在上面: 登记前它可能已被摘下并进入待回收列表,
+    // 而扫描线程可能在我们登记之前就看过槽位了。登记与重读都用 seq_cst, 与扫描线程
+    // 「摘下节点 -> 读所有槽位」构成 Dekker 式握手: 要么它看到登记, 要么我们看到新的 src
+    template <typename T>
+    T* Protect(const std::atomic<T*>& src) noexcept {
+        T* p = src.load(std::memory_order_relaxed);
+        while (true) {
+            record_->pointer.store(p, std::memory_order_seq_cst);
+            T* q = src.load(std::memory_order_seq_cst);
+            if (p == q) {
+                return p;
+            }
+            p = q;
+        }
+    }
+
+    void Reset() noexcept { record_->pointer.store(nullptr, std::memory_order_release); }
+
+private:
+    using Record = HazardPointerDomain::Record;
+
+    struct RecordCache {
+        std::vector<Record*> free;
+        ~RecordCache() {
+            for (Record* r : free) {
+                HazardPointerDomain::Global().ReleaseRecord(r);
+            }
+        }
+
+        Record* Take() {
+            if (free.empty()) {
+                return HazardPointerDomain::Global().AcquireRecord();
+            }
+            Record* r = free.back();
+            free.pop_back();
+            return r;
+        }
+
+        void Give(Record* r) { free.push_back(r); }
+    };
+
+    static RecordCache& Cache() {
+        static thread_local RecordCache cache;
+        return cache;
+    }
+
+    Record* record_;
+};
+
+// 竞争策略: CAS head_ 失败之后做什么
+// 默认策略什么也不做, 直接重试
+struct NoElimination {
+    bool TryHandOff(void* /*node*/) noexcept { return false; }
+    void* TryTake() noexcept { return nullptr; }
+};
+
+// 消除退避数组 (Hendler, Shavit, Yerushalmi 2004)
+// 一次 Push 紧接着一次 Pop, 对栈的状态没有任何影响; 所以 CAS head_ 失败时, Push 把节点放到
+// 旁边数组的一个随机槽位里等一小会儿, 同时也 CAS 失败的 Pop 去随机槽位里拿, 两者直接配对抵消,
+// 都不用再碰 head_。线程越多, 配对的机会越大, head_ 上的竞争反而越小
+// NOTE: 只有 Push 在槽位里等, Pop 只看一眼: 槽位状态 空 -> 节点(Push 放入) -> kTaken(Pop 拿走)
+// -> 空(由放入的 Push 清空); 槽位从放入到清空都归同一个 Push, 所以比较节点地址不会有 ABA
+template <std::size_t kSlots = 16, uint32_t kSpins = 256>
+class EliminationArray {
+public:
+    // Push 侧: 节点被 Pop 拿走返回 true; 超时撤回返回 false, 调用方回去重试 CAS head_
+    bool TryHandOff(void* node) noexcept {
+        Slot& slot = slots_[Pick()];
+        uintptr_t expected = kEmpty;
+        const auto value = reinterpret_cast<uintptr_t>(node);
+        // release: 拿走节点的 Pop 要看到节点里的数据
+        if (!slot.value.compare_exchange_strong(expected, value, std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+            return false;  // 槽位被别的 Push 占着
+        }
+        for (uint32_t i = 0; i < kSpins; ++i) {
+            if (slot.value.load(std::memory_order_relaxed) == kTaken) {
+                break;
+            }
+            CpuRelax();
+        }
+        expected = value;
+        if (slot.value.compare_exchange_strong(expected, kEmpty, std::memory_order_relaxed)) {
+            Adapt(false);  // 没等到 Pop, 撤回
+            return false;
+        }
+        // 撤回失败说明已被拿走 (此时槽位一定是 kTaken); 节点归 Pop 了, 由本线程清空槽位
+        slot.value.store(kEmpty, std::memory_order_relaxed);
+        Adapt(true);
+        return true;
+    }
+
+    // Pop 侧: 拿到一个正在等待的 Push 的节点, 没有则返回 nullptr
+    void* TryTake() noexcept {
+        Slot& slot = slots_[Pick()];
+        uintptr_t value = slot.value.load(std::memory_order_relaxed);
+        if (value == kEmpty || value == kTaken) {
+            return nullptr;
+        }
+        if (!slot.value.compare_exchange_strong(value, kTaken, std::memory_order_acquire,
+                                                std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return reinterpret_cast<void*>(value);
+    }
+
+private:
+    static constexpr uintptr_t kEmpty = 0;
+    static constexpr uintptr_t kTaken = 1;  // 节点至少按 2 对齐, 不会与节点地址冲突
+
+    struct alignas(64) Slot {
+        std::atomic<uintptr_t> value{kEmpty};
+    };
+
+    // 每个线程自适应地只用前 range 个槽位: 配对成功说明竞争大, 扩大范围分散开;
+    // 超时说明人少, 缩小范围让 Push 和 Pop 更容易碰上
+    struct LocalState {
+        uint64_t random = std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1;
+        std::size_t range = 1;
+    };
+
+    static LocalState& Local() noexcept {
+        static thread_local LocalState state;
+        return state;
+    }
+
+    static std::size_t Pick() noexcept {
+        LocalState& local = Local();
+        local.random ^= local.random << 13;
+        local.random ^= local.random >> 7;
+        local.random ^= local.random << 17;
+        return static_cast<std::size_t>(local.random % local.range);
+    }
+
+    static void Adapt(bool success) noexcept {
+        LocalState& local = Local();
+        if (success) {
+            local.range = std::min(local.range * 2, kSlots);
+        } else {
+            local.range = std::max<std::size_t>(local.range / 2, 1);
+        }
+    }
+
+    static void CpuRelax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    Slot slots_[kSlots];
+};
+
+// Contention 是 CAS head_ 失败时的竞争策略: NoElimination 或 EliminationArray<...>
+template <typename T, typename Contention = NoElimination>
+class HazardLockFreeStack {
+public:
+    HazardLockFreeStack() = default;
+    ~HazardLockFreeStack() {
+        // 析构时不应再有并发访问, 直接释放剩下的节点
+        Node* node = head_.load(std::memory_order_relaxed);
+        while (node != nullptr) {
+            delete std::exchange(node, node->next_);
+        }
+    }
+    HazardLockFreeStack(HazardLockFreeStack const&) = delete;
+    HazardLockFreeStack(HazardLockFreeStack&&) = delete;
+
+    void Push(T data) {
+        auto* new_node = new Node{std::move(data)};
+        new_node->next_ = head_.load(std::memory_order_relaxed);
+        // NOTE: Push 不解引用共享节点, 不需要风险指针; release 让 Pop 方看到完整的节点
+        while (!head_.compare_exchange_weak(new_node->next_, new_node, std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+            if (contention_.TryHandOff(new_node)) {
+                return;  // 被一个 Pop 直接拿走了
+            }
+            new_node->next_ = head_.load(std::memory_order_relaxed);
+        }
+    }
+
+    std::optional<T> Pop() {
+        HazardPointer hp;
+        Node* old_head = nullptr;
+        while (true) {
+            old_head = hp.Protect(head_);
+            if (old_head == nullptr) {
+                return std::nullopt;
+            }
+            // NOTE: 有风险指针保护, 读 old_head->next_ 是安全的, 节点不会在这时被释放;
+            // 而且节点地址不会被复用, CAS 成功就说明栈顶确实没变过 (没有 ABA)
+            if (head_.compare_exchange_strong(old_head, old_head->next_,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                break;
+            }
+            if (void* taken = contention_.TryTake()) {
+                // NOTE: 这个节点从没进过栈, 别的线程不可能登记过它, 可以直接 delete
+                hp.Reset();
+                std::unique_ptr<Node> node{static_cast<Node*>(taken)};
+                return std::optional<T>{std::move(node->data_)};
+            }
+        }
+        // CAS 成功后节点只属于本线程: 别的线程最多还在读它的 next_, 不会碰 data_
+        hp.Reset();
+        std::optional<T> result{std::move(old_head->data_)};
+        HazardPointerDomain::Global().Retire(old_head);
+        return result;
+    }
+
+private:
+    struct Node {
+        T data_;
+        Node* next_{nullptr};
+        explicit Node(T data) : data_(std::move(data)) {}
+    };
+
+    static_assert(std::atomic<Node*>::is_always_lock_free);
+
+    alignas(64) std::atomic<Node*> head_{nullptr};
+    Contention contention_;  // 消除数组的槽位各自独占缓存行, 不与 head_ 伪共享
+};
+
+// --- 基准测试 ---
+
+// lockfree_stack.cpp 的精简副本: std::atomic<std::shared_ptr<Node>>
+template <typename T>
+class SharedPtrStack {
+public:
+    void Push(T data) {
+        auto new_node{std::make_shared<Node>(std::move(data))};
+        new_node->next_ = head_.load(std::memory_order_acquire);
+        while (!head_.compare_exchange_weak(new_node->next_, new_node, std::memory_order_release,
+                                            std::memory_order_acquire)) {
+        }
+    }
+
+    std::optional<T> Pop() {
+        auto old_head{head_.load(std::memory_order_acquire)};
+        while (old_head &&
+               !head_.compare_exchange_weak(old_head, old_head->next_, std::memory_order_acq_rel,
+                                            std::memory_order_acquire)) {
+        }
+        if (old_head) {
+            return old_head->data_;
+        }
+        return std::nullopt;
+    }
+
+    bool IsLockFree() const { return head_.is_lock_free(); }
+
+private:
+    struct Node {
+        T data_;
+        std::shared_ptr<Node> next_{nullptr};
+        explicit Node(T data) : data_(std::move(data)) {}
+    };
+
+    std::atomic<std::shared_ptr<Node>> head_;
+};
+
+// lockfree_stack_cpp17.cpp 的精简副本: shared_ptr + std::atomic_load 系列自由函数
+// NOTE: 这些自由函数在 C++20 中已弃用, 这里只为对比
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+template <typename T>
+class AtomicLoadStack {
+public:
+    void Push(T data) {
+        auto new_node = std::make_shared<Node>(std::move(data));
+        new_node->next_ = std::atomic_load(&head_);
+        while (!std::atomic_compare_exchange_weak(&head_, &new_node->next_, new_node)) {
+        }
+    }
+
+    std::optional<T> Pop() {
+        std::shared_ptr<Node> old_head = std::atomic_load(&head_);
+        while (old_head && !std::atomic_compare_exchange_weak(&head_, &old_head, old_head->next_)) {
+        }
+        if (old_head) {
+            return old_head->data_;
+        }
+        return std::nullopt;
+    }
+
+    bool IsLockFree() const { return std::atomic_is_lock_free(&head_); }
+
+private:
+    struct Node {
+        T data_;
+        std::shared_ptr<Node> next_;
+        explicit Node(T data) : data_(std::move(data)), next_(nullptr) {}
+    };
+
+    std::shared_ptr<Node> head_;
+};
+#pragma GCC diagnostic pop
+
+// 每个线程交替 Push/Pop, 共 total_ops 次操作, 返回每秒百万次操作
+template <typename Stack>
+double BenchPushPop(std::size_t threads, std::size_t total_ops) {
+    Stack stack;
+    for (int i = 0; i < 1024; ++i) {  // 预先放一些元素, 让 Pop 大多能取到
+        stack.Push(i);
+    }
+    const std::size_t per_thread = total_ops / threads / 2;
+    std::atomic<bool> go{false};
+    std::vector<std::jthread> workers;
+    for (std::size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&stack, &go, per_thread, t] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (std::size_t i = 0; i < per_thread; ++i) {
+                stack.Push(static_cast<int>(t * per_thread + i));
+                stack.Pop();
+            }
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    workers.clear();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(per_thread * threads * 2) / elapsed.count() / 1e6;
+}
+
+// 4 个生产者、4 个消费者, 检查弹出的元素不重不漏
+template <typename Stack>
+void TestProducerConsumer(const char* name) {
+    Stack stack;
+    std::atomic<long long> sum_popped = 0;
+    std::atomic<int> pop_count = 0;
+    const int kItemsPerProducer = 2000;
+    const int kProducerCount = 4;
+    const int kConsumerCount = 4;
+    const int kTotalItems = kItemsPerProducer * kProducerCount;
+
+    {
+        std::vector<std::jthread> threads;
+        for (int i = 0; i < kProducerCount; ++i) {
+            threads.emplace_back([&stack, i] {
+                for (int j = 0; j < kItemsPerProducer; ++j) {
+                    stack.Push(i * kItemsPerProducer + j);
+                }
+            });
+        }
+        for (int i = 0; i < kConsumerCount; ++i) {
+            threads.emplace_back([&stack, &sum_popped, &pop_count] {
+                while (pop_count.load() < kTotalItems) {
+                    if (auto value = stack.Pop()) {
+                        sum_popped += *value;
+                        pop_count++;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+    }
+
+    long long expected_sum = (long long)(kTotalItems - 1) * kTotalItems / 2;
+    std::cout << name << ": 弹出元素数量 " << pop_count.load() << ", 总和 " << sum_popped.load()
+              << ", 期望 " << expected_sum << ", ";
+    if (sum_popped.load() == expected_sum && pop_count.load() == kTotalItems) {
+        std::cout << "测试成功！\n";
+    } else {
+        std::cout << "测试失败！\n";
+    }
+}
+
+using EliminationStack = HazardLockFreeStack<int, EliminationArray<>>;
+
+int main() {
+    TestProducerConsumer<HazardLockFreeStack<int>>("hazard pointer");
+    TestProducerConsumer<EliminationStack>("hazard pointer + elimination");
+
+    std::cout << "\nis_lock_free: atomic<shared_ptr> " << SharedPtrStack<int>{}.IsLockFree()
+              << ", atomic_load(&shared_ptr) " << AtomicLoadStack<int>{}.IsLockFree()
+              << ", atomic<Node*> " << std::atomic<void*>{}.is_lock_free() << "\n";
+
+    std::cout << "\n--- Benchmark: push+pop pairs, Mops/s ---" << std::endl;
+    std::cout << "threads\tatomic<shared_ptr>\tatomic_load\thazard pointer\t+elimination"
+              << std::endl;
+    constexpr std::size_t kOps = 2'000'000;
+    for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+        double shared = BenchPushPop<SharedPtrStack<int>>(threads, kOps);
+        double free_fn = BenchPushPop<AtomicLoadStack<int>>(threads, kOps);
+        double hazard = BenchPushPop<HazardLockFreeStack<int>>(threads, kOps);
+        double elimination = BenchPushPop<EliminationStack>(threads, kOps);
+        std::cout << threads << "\t" << shared << "\t\t\t" << free_fn << "\t\t" << hazard
+                  << "\t\t" << elimination << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,434 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// 有界无锁环形队列 (Dmitry Vyukov 的 bounded MPMC queue)
+// LockFreeStack 是 LIFO, 且每个元素一次堆分配; 生产者/消费者流水线需要 FIFO, 这里用一块预先分配好的
+// 环形数组, 入队/出队都不再分配内存:
+//   * 每个槽位带一个序号 seq, 初始为槽位下标 i
+//   * 生产者拿到位置 pos, 槽位 seq == pos 表示可写; 写完把 seq 设为 pos + 1 交给消费者
+//   * 消费者拿到位置 pos, 槽位 seq == pos + 1 表示可读; 读完把 seq 设为 pos + 容量,
+//     留给下一圈的生产者
+// 生产者之间只在 enqueue_pos_ 上 CAS 竞争, 消费者之间只在 dequeue_pos_ 上竞争, 两边互不干扰
+// NOTE: 容量向上取整到 2 的幂, 下标用 & mask_ 代替取模
+// NOTE: 队列满时 Push 返回 false 且不消耗参数, 调用方可以稍后重试同一个值
+
+enum class QueueConcurrency { kMpmc, kSpsc };
+
+constexpr std::size_t kCacheLineSize = 64;
+
+template <typename T, QueueConcurrency kConcurrency = QueueConcurrency::kMpmc>
+class BoundedQueue {
+    // Pop 在抢到槽位后把元素移出来, 移动构造抛异常会让槽位永远卡住
+    static_assert(std::is_nothrow_move_constructible_v<T>, "T 的移动构造必须是 noexcept");
+
+public:
+    explicit BoundedQueue(std::size_t capacity)
+        : mask_(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1),
+          cells_(std::make_unique<Cell[]>(mask_ + 1)) {
+        for (std::size_t i = 0; i <= mask_; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~BoundedQueue() {
+        while (Pop()) {
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool Push(const T& data) { return Emplace(data); }
+    bool Push(T&& data) { return Emplace(std::move(data)); }
+
+    // NOTE: 抢到槽位之后就必须把 seq 推进到 pos + 1, 否则消费者会永远停在这个槽位上;
+    // 构造可能抛异常时先在槽位外构造好临时对象, 抢到槽位后只做不抛异常的移动构造
+    // (这时若队列已满, 右值实参已被移进临时对象, 返回 false 后不能再重试同一个值)
+    template <typename... Args>
+    bool Emplace(Args&&... args) {
+        if constexpr (std::is_nothrow_constructible_v<T, Args&&...>) {
+            std::size_t pos;
+            Cell* cell = ClaimForPush(pos);
+            if (cell == nullptr) {
+                return false;
+            }
+            ::new (cell->storage) T(std::forward<Args>(args)...);
+            cell->seq.store(pos + 1, std::memory_order_release);
+            return true;
+        } else {
+            T value(std::forward<Args>(args)...);
+            return Emplace(std::move(value));
+        }
+    }
+
+    std::optional<T> Pop() {
+        std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // 生产者还没写到这里, 队列空
+                return std::nullopt;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        T* slot = std::launder(reinterpret_cast<T*>(cell->storage));
+        std::optional<T> out{std::move(*slot)};
+        slot->~T();
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return out;
+    }
+
+    std::size_t Capacity() const noexcept { return mask_ + 1; }
+
+    // 近似值: 并发修改时只能当作参考
+    std::size_t SizeApprox() const noexcept {
+        std::size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+        std::size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+        return tail >= head ? tail - head : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> seq;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    // 抢一个可写的槽位, 队列满时返回 nullptr
+    Cell* ClaimForPush(std::size_t& pos) noexcept {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell* cell = &cells_[pos & mask_];
+            std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                // 槽位空闲, 抢这个位置; CAS 失败时 pos 被更新为最新值, 重新看对应的槽位
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return cell;
+                }
+            } else if (diff < 0) {
+                // 槽位还留着上一圈的数据, 队列满
+                return nullptr;
+            } else {
+                // 别的生产者已经抢走了这个位置
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // NOTE: 生产者和消费者的位置各占一个缓存行, 避免两边互相作废对方的缓存
+    const std::size_t mask_;
+    const std::unique_ptr<Cell[]> cells_;
+    alignas(kCacheLineSize) std::atomic<std::size_t> enqueue_pos_{0};
+    alignas(kCacheLineSize) std::atomic<std::size_t> dequeue_pos_{0};
+};
+
+// 单生产者单消费者的特化: 没有竞争者, 不需要 CAS 也不需要每个槽位的序号
+// head_ 只由消费者写, tail_ 只由生产者写; 每一方各缓存一份对方的位置, 只有看起来满/空时才去读
+// 对方的缓存行, 稳态下两边几乎不共享缓存行
+template <typename T>
+class BoundedQueue<T, QueueConcurrency::kSpsc> {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "T 的移动构造必须是 noexcept");
+
+public:
+    explicit BoundedQueue(std::size_t capacity)
+        : mask_(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1),
+          slots_(std::make_unique<Slot[]>(mask_ + 1)) {}
+
+    ~BoundedQueue() {
+        while (Pop()) {
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool Push(const T& data) { return Emplace(data); }
+    bool Push(T&& data) { return Emplace(std::move(data)); }
+
+    // 只能由唯一的生产者线程调用
+    // NOTE: tail_ 在构造完成后才推进, 构造抛异常时槽位仍是空的, 不需要额外处理
+    template <typename... Args>
+    bool Emplace(Args&&... args) {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_) {
+                return false;
+            }
+        }
+        ::new (slots_[tail & mask_].storage) T(std::forward<Args>(args)...);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 只能由唯一的消费者线程调用
+    std::optional<T> Pop() {
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) {
+                return std::nullopt;
+            }
+        }
+        T* slot = std::launder(reinterpret_cast<T*>(slots_[head & mask_].storage));
+        std::optional<T> out{std::move(*slot)};
+        slot->~T();
+        head_.store(head + 1, std::memory_order_release);
+        return out;
+    }
+
+    std::size_t Capacity() const noexcept { return mask_ + 1; }
+
+    std::size_t SizeApprox() const noexcept {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        return tail >= head ? tail - head : 0;
+    }
+
+private:
+    struct Slot {
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    const std::size_t mask_;
+    const std::unique_ptr<Slot[]> slots_;
+    alignas(kCacheLineSize) std::atomic<std::size_t> tail_{0};  // 生产者写
+    std::size_t head_cache_{0};                                 // 生产者看到的 head_
+    alignas(kCacheLineSize) std::atomic<std::size_t> head_{0};  // 消费者写
+    std::size_t tail_cache_{0};                                 // 消费者看到的 tail_
+};
+
+template <typename T>
+using MpmcQueue = BoundedQueue<T, QueueConcurrency::kMpmc>;
+template <typename T>
+using SpscQueue = BoundedQueue<T, QueueConcurrency::kSpsc>;
+
+// --- 基准测试 ---
+
+// lockfree_stack.cpp 中的 LockFreeStack (atomic<shared_ptr> 版本), 作为对照
+template <typename T>
+class LockFreeStack {
+public:
+    bool Push(T data) {
+        auto new_node{std::make_shared<Node>(std::move(data))};
+        new_node->next_ = head_.load();
+        while (!head_.compare_exchange_weak(new_node->next_, new_node)) {
+        }
+        return true;
+    }
+
+    std::optional<T> Pop() {
+        auto old_head{head_.load()};
+        while (old_head && !head_.compare_exchange_weak(old_head, old_head->next_)) {
+        }
+        if (old_head) {
+            return std::move(old_head->data_);
+        }
+        return std::nullopt;
+    }
+
+private:
+    struct Node {
+        T data_;
+        std::shared_ptr<Node> next_;
+        explicit Node(T data) : data_(std::move(data)) {}
+    };
+
+    std::atomic<std::shared_ptr<Node>> head_;
+};
+
+// std::mutex + std::queue, 作为对照
+template <typename T>
+class MutexQueue {
+public:
+    bool Push(T data) {
+        std::lock_guard lk{mtx_};
+        queue_.push(std::move(data));
+        return true;
+    }
+
+    std::optional<T> Pop() {
+        std::lock_guard lk{mtx_};
+        if (queue_.empty()) {
+            return std::nullopt;
+        }
+        std::optional<T> out{std::move(queue_.front())};
+        queue_.pop();
+        return out;
+    }
+
+private:
+    std::mutex mtx_;
+    std::queue<T> queue_;
+};
+
+// pairs 个生产者和 pairs 个消费者, 每个生产者推 items 个元素; 返回每秒传递的元素数(百万)
+template <typename Queue>
+double BenchPipeline(Queue& queue, int pairs, int items) {
+    std::atomic<long long> sum{0};
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::vector<std::jthread> threads;
+        for (int p = 0; p < pairs; ++p) {
+            threads.emplace_back([&queue, items] {
+                for (int i = 0; i < items; ++i) {
+                    while (!queue.Push(i)) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+            threads.emplace_back([&queue, &sum, items] {
+                long long local = 0;
+                for (int i = 0; i < items; ++i) {
+                    std::optional<int> v;
+                    while (!(v = queue.Pop())) {
+                        std::this_thread::yield();
+                    }
+                    local += *v;
+                }
+                sum.fetch_add(local, std::memory_order_relaxed);
+            });
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    long long expected = static_cast<long long>(items - 1) * items / 2 * pairs;
+    if (sum.load() != expected) {
+        std::cout << "[checksum mismatch] ";
+    }
+    return static_cast<double>(pairs) * items / elapsed.count() / 1e6;
+}
+
+// 构造时可能抛异常的元素: 文本为 "bad" 时抛出, 模拟 std::string 的 bad_alloc
+struct FragileItem {
+    std::string text;
+
+    explicit FragileItem(const char* s) : text(s) {
+        if (text == "bad") {
+            throw std::runtime_error("FragileItem: construction failed");
+        }
+    }
+    FragileItem(const FragileItem& other) : FragileItem(other.text.c_str()) {}
+    FragileItem(FragileItem&&) noexcept = default;
+};
+
+// 构造抛异常后队列必须仍然可用: 不能有槽位卡在「已抢到但未发布」的状态
+template <typename Queue>
+bool SurvivesThrowingConstructor() {
+    Queue queue{4};
+    int thrown = 0;
+    for (const char* s : {"a", "bad", "b", "bad", "c"}) {
+        try {
+            queue.Emplace(s);
+        } catch (const std::runtime_error&) {
+            ++thrown;
+        }
+    }
+    try {
+        FragileItem bad{"ok"};
+        bad.text = "bad";
+        queue.Push(bad);  // 拷贝构造抛异常
+    } catch (const std::runtime_error&) {
+        ++thrown;
+    }
+    std::string order;
+    while (auto v = queue.Pop()) {
+        order += v->text;
+    }
+    int refilled = 0;  // 抛异常不应占用容量
+    while (queue.Emplace("x")) {
+        ++refilled;
+    }
+    return thrown == 3 && order == "abc" && refilled == static_cast<int>(queue.Capacity());
+}
+
+int main() {
+    std::cout << "--- FIFO order and bounded capacity ---\n";
+    {
+        MpmcQueue<std::string> queue{5};  // 取整为 8
+        int pushed = 0;
+        while (queue.Push("item " + std::to_string(pushed))) {
+            ++pushed;
+        }
+        std::cout << "capacity " << queue.Capacity() << ", pushed " << pushed << " before full\n";
+        while (auto v = queue.Pop()) {
+            std::cout << *v << (queue.SizeApprox() ? ", " : "\n");
+        }
+
+        SpscQueue<std::unique_ptr<int>> spsc{4};
+        std::jthread producer{[&spsc] {
+            for (int i = 0; i < 1000; ++i) {
+                auto p = std::make_unique<int>(i);
+                while (!spsc.Push(std::move(p))) {  // 失败时 p 未被移走, 可以重试
+                    std::this_thread::yield();
+                }
+            }
+        }};
+        bool ordered = true;
+        for (int i = 0; i < 1000; ++i) {
+            std::optional<std::unique_ptr<int>> v;
+            while (!(v = spsc.Pop())) {
+                std::this_thread::yield();
+            }
+            ordered = ordered && **v == i;
+        }
+        std::cout << "SPSC 1000 items in order: " << (ordered ? "yes" : "no") << "\n";
+
+        std::cout << "survives throwing constructor: MPMC "
+                  << (SurvivesThrowingConstructor<MpmcQueue<FragileItem>>() ? "yes" : "no")
+                  << ", SPSC "
+                  << (SurvivesThrowingConstructor<SpscQueue<FragileItem>>() ? "yes" : "no")
+                  << "\n";
+    }
+
+    constexpr int kItems = 200'000;
+    constexpr std::size_t kCapacity = 1024;
+    std::cout << "\n--- Benchmark: N producers + N consumers, M items/s (" << kItems
+              << " items in total) ---\n";
+    std::cout << "pairs\tMpmcQueue\tLockFreeStack\tmutex+queue\n";
+    for (int pairs = 1; pairs <= 64; pairs *= 2) {
+        MpmcQueue<int> mpmc{kCapacity};
+        LockFreeStack<int> stack;
+        MutexQueue<int> locked;
+        int items = kItems / pairs;  // 总量固定, 线程多时避免跑太久
+        std::cout << pairs << '\t' << BenchPipeline(mpmc, pairs, items) << "\t\t"
+                  << BenchPipeline(stack, pairs, items) << "\t\t"
+                  << BenchPipeline(locked, pairs, items) << "\n";
+    }
+
+    std::cout << "\n--- Benchmark: 1 producer + 1 consumer, M items/s ---\n";
+    {
+        SpscQueue<int> spsc{kCapacity};
+        MpmcQueue<int> mpmc{kCapacity};
+        LockFreeStack<int> stack;
+        MutexQueue<int> locked;
+        std::cout << "SpscQueue\t" << BenchPipeline(spsc, 1, kItems) << "\n";
+        std::cout << "MpmcQueue\t" << BenchPipeline(mpmc, 1, kItems) << "\n";
+        std::cout << "LockFreeStack\t" << BenchPipeline(stack, 1, kItems) << "\n";
+        std::cout << "mutex+queue\t" << BenchPipeline(locked, 1, kItems) << "\n";
+    }
+
+    return 0;
+}
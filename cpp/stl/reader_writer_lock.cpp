@@ -1,5 +1,211 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <climits>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <ostream>
+#include <iterator>
 #include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// -DRWLOCK_PROFILE=1: 记录 RWLock 的竞争情况 (读/写各自的等待时间和持有时间直方图、被等待写者挡住的
+// 读者数、最长的写者等待), 用 RWLock::Profile() 取快照并打印摘要
+// 关闭时(默认)分析器是空类型, 所有埋点都是空的内联函数, RWLock 的大小和代码与不加埋点时相同
+#ifndef RWLOCK_PROFILE
+#define RWLOCK_PROFILE 0
+#endif
+
+// 按 2 的幂分桶的延迟直方图: 第 i 个桶统计 [2^(i-1), 2^i) 纳秒, 第 0 个桶只有 0ns
+struct LatencyHistogram {
+    static constexpr std::size_t kBuckets = 48;  // 最大桶上界 2^47ns, 约 39 小时
+
+    std::array<uint64_t, kBuckets> counts{};
+
+    static std::size_t BucketOf(std::chrono::nanoseconds d) noexcept {
+        const auto ns = static_cast<uint64_t>(std::max<int64_t>(d.count(), 0));
+        return std::min<std::size_t>(std::bit_width(ns), kBuckets - 1);
+    }
+
+    void Add(std::chrono::nanoseconds d) noexcept { ++counts[BucketOf(d)]; }
+
+    uint64_t Count() const noexcept {
+        uint64_t n = 0;
+        for (uint64_t c : counts) {
+            n += c;
+        }
+        return n;
+    }
+
+    // 第 q (0~1) 分位所在桶的上界; 没有样本时返回 0
+    std::chrono::nanoseconds Percentile(double q) const noexcept {
+        const uint64_t total = Count();
+        if (total == 0) {
+            return std::chrono::nanoseconds{0};
+        }
+        const auto rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        std::size_t i = 0;
+        while (i + 1 < kBuckets && (seen += counts[i]) < rank) {
+            ++i;
+        }
+        return std::chrono::nanoseconds{i == 0 ? 0 : int64_t{1} << i};
+    }
+};
+
+// RWLock::Profile() 的返回值
+struct RWLockProfile {
+    LatencyHistogram read_wait;   // ReadLock 从调用到拿到锁
+    LatencyHistogram read_hold;   // ReadLock 返回到 ReadUnlock
+    LatencyHistogram write_wait;  // WriteLock 从调用到拿到锁
+    LatencyHistogram write_hold;  // WriteLock 返回到 WriteUnlock
+    uint64_t readers_blocked{0};  // 需要等待的 ReadLock 次数
+    // 其中没有活跃写者、只是因为有写者在等而被挡住的次数 (写者优先的代价)
+    uint64_t readers_blocked_by_waiting_writer{0};
+    std::chrono::nanoseconds max_writer_wait{0};
+
+    void Print(std::ostream &os) const {
+        auto us = [](std::chrono::nanoseconds d) { return static_cast<double>(d.count()) / 1e3; };
+        auto row = [&](const char *name, const LatencyHistogram &wait,
+                       const LatencyHistogram &hold) {
+            os << name << "\t" << wait.Count() << "\twait p50/p99 " << us(wait.Percentile(0.5))
+               << "/" << us(wait.Percentile(0.99)) << "us\thold p50/p99 "
+               << us(hold.Percentile(0.5)) << "/" << us(hold.Percentile(0.99)) << "us\n";
+        };
+        row("read", read_wait, read_hold);
+        row("write", write_wait, write_hold);
+        os << "readers blocked: " << readers_blocked << " (by a waiting writer only: "
+           << readers_blocked_by_waiting_writer << ")\n";
+        os << "longest writer wait: " << us(max_writer_wait) << "us\n";
+    }
+};
+
+// 埋点分两步, 让取时间戳和查线程本地表都不占用 RWLock 的 mtx_ 临界区:
+//   * On*: 在 mtx_ 之外调用, 取时间戳并算出这次的等待/持有时间 (Sample)
+//   * Count*/Record*: 在 mtx_ 之下调用, 只把 Sample 累加进计数器, 因此计数器不需要原子操作
+// NOTE: 读锁的等待时间在 ReadUnlock 时才和持有时间一起记录, 持有中的读锁不会出现在快照里
+template <bool kEnabled>
+class RWLockProfiler {
+public:
+    struct Stamp {};
+    struct Sample {};
+    static Stamp Now() noexcept { return {}; }
+    void CountReadBlocked(bool, bool) noexcept {}
+    void OnReadAcquired(const void *, Stamp) noexcept {}
+    Sample OnReadReleased(const void *) noexcept { return {}; }
+    void RecordRead(const Sample &) noexcept {}
+    void OnWriteAcquired(Stamp) noexcept {}
+    Sample OnWriteReleased() noexcept { return {}; }
+    void RecordWrite(const Sample &) noexcept {}
+    RWLockProfile Snapshot() const noexcept { return {}; }
+};
+
+template <>
+class RWLockProfiler<true> {
+public:
+    using Stamp = std::chrono::steady_clock::time_point;
+    static Stamp Now() noexcept { return std::chrono::steady_clock::now(); }
+
+    struct Sample {
+        std::chrono::nanoseconds wait{0};
+        std::chrono::nanoseconds hold{0};
+        bool valid{false};  // 没找到对应的加锁记录(嵌套过深)时为 false, 不计入直方图
+    };
+
+    void CountReadBlocked(bool blocked, bool by_waiting_writer) noexcept {
+        profile_.readers_blocked += blocked;
+        profile_.readers_blocked_by_waiting_writer += by_waiting_writer;
+    }
+
+    void OnReadAcquired(const void *lock, Stamp start) noexcept {
+        // NOTE: 同一线程可能同时持有多个 RWLock 的读锁, 按锁地址记录本线程每次加锁的时间
+        // 固定容量的数组, 加解锁路径上不分配内存; 同时持有超过 kMaxHeldReads 个读锁时不再采样
+        HeldReads &held = Held();
+        if (held.size < kMaxHeldReads) {
+            held.entries[held.size++] = {lock, start, Now()};
+        }
+    }
+
+    Sample OnReadReleased(const void *lock) noexcept {
+        HeldReads &held = Held();
+        for (std::size_t i = held.size; i-- > 0;) {
+            if (held.entries[i].lock == lock) {
+                const HeldRead read = held.entries[i];
+                std::copy(held.entries.begin() + static_cast<std::ptrdiff_t>(i) + 1,
+                          held.entries.begin() + static_cast<std::ptrdiff_t>(held.size),
+                          held.entries.begin() + static_cast<std::ptrdiff_t>(i));
+                --held.size;
+                return {read.acquired - read.start, Now() - read.acquired, true};
+            }
+        }
+        return {};
+    }
+
+    void RecordRead(const Sample &sample) noexcept {
+        if (sample.valid) {
+            profile_.read_wait.Add(sample.wait);
+            profile_.read_hold.Add(sample.hold);
+        }
+    }
+
+    // NOTE: write_* 只由当前持有写锁的线程访问, 前后两个写者之间经由 mtx_ 建立 happens-before
+    void OnWriteAcquired(Stamp start) noexcept {
+        write_start_ = start;
+        write_acquired_ = Now();
+    }
+
+    Sample OnWriteReleased() noexcept {
+        return {write_acquired_ - write_start_, Now() - write_acquired_, true};
+    }
+
+    void RecordWrite(const Sample &sample) noexcept {
+        profile_.write_wait.Add(sample.wait);
+        profile_.write_hold.Add(sample.hold);
+        profile_.max_writer_wait = std::max(profile_.max_writer_wait, sample.wait);
+    }
+
+    const RWLockProfile &Snapshot() const noexcept { return profile_; }
+
+private:
+    static constexpr std::size_t kMaxHeldReads = 8;
+
+    struct HeldRead {
+        const void *lock;
+        Stamp start;     // 调用 ReadLock 的时刻
+        Stamp acquired;  // 拿到读锁的时刻
+    };
+
+    struct HeldReads {
+        std::array<HeldRead, kMaxHeldReads> entries;
+        std::size_t size{0};
+    };
+
+    static HeldReads &Held() noexcept {
+        thread_local HeldReads held;
+        return held;
+    }
+
+    RWLockProfile profile_;
+    Stamp write_start_{};
+    Stamp write_acquired_{};
+};
 
 // 写者优先: 这里的「优先」并不意味着写者可以“插队”
 // 而是: 当一个写者线程正在等待时, 新的读者线程将不会被授权, 以防止写者饥饿
@@ -17,6 +223,9 @@ private:
     std::condition_variable cv_can_read_;   // 「读者可以读」
     std::condition_variable cv_can_write_;  // 「写者可以写」
 
+    // NOTE: 关闭 RWLOCK_PROFILE 时是空类型, no_unique_address 让它不占空间
+    [[no_unique_address]] RWLockProfiler<RWLOCK_PROFILE> profiler_;
+
 public:
     RWLock() = default;
     ~RWLock() = default;
@@ -27,18 +236,26 @@ public:
     // ========================= 读上锁/解锁 =========================
     // 获取读锁
     void ReadLock() {
-        std::unique_lock lk{mtx_};
-        // NOTE: 「写者优先」这里体现!
-        // 读者必须等待直到以下所有条件成立才可以读
-        //  * 没有正在活跃的写者 false
-        //  * 没有等待写者 == 0
-        cv_can_read_.wait(lk, [this] { return !writer_active_ && waiting_writers_ == 0; });
-        ++reader_count_;  // ReadLock 和 ReadUnlock 是一个组合, 在 ReadUnlock 最后 notify
+        auto start = profiler_.Now();
+        {
+            std::unique_lock lk{mtx_};
+            profiler_.CountReadBlocked(writer_active_ || waiting_writers_ > 0,
+                                       !writer_active_ && waiting_writers_ > 0);
+            // NOTE: 「写者优先」这里体现!
+            // 读者必须等待直到以下所有条件成立才可以读
+            //  * 没有正在活跃的写者 false
+            //  * 没有等待写者 == 0
+            cv_can_read_.wait(lk, [this] { return !writer_active_ && waiting_writers_ == 0; });
+            ++reader_count_;  // ReadLock 和 ReadUnlock 是一个组合, 在 ReadUnlock 最后 notify
+        }
+        profiler_.OnReadAcquired(this, start);
     }
 
     // 释放读锁
     void ReadUnlock() {
+        auto sample = profiler_.OnReadReleased(this);
         std::lock_guard lk{mtx_};
+        profiler_.RecordRead(sample);
         --reader_count_;
         // NOTE: 唤醒写者是有条件的! 首先读者已经没了, 其次确实存在等待的写者, 不然也没必要唤醒
         // 如果这是最后一个离开的读者, 并且有写者在等待, 则唤醒一个写者
@@ -51,19 +268,25 @@ public:
     // ========================= 写上锁/解锁 =========================
     // 获取写锁
     void WriteLock() {
-        std::unique_lock lk{mtx_};
-        ++waiting_writers_;  // NOTE: 进入等待队列, 不是直接变成活跃, 因为还没获得锁!!
-        // 写者必须等待直到以下所有条件成立才可以写(体现: 写-读/写互斥)
-        //  * 没有正在活跃的写者 false
-        //  * 没有活跃读者 == 0
-        cv_can_write_.wait(lk, [this] { return !writer_active_ && reader_count_ == 0; });
-        writer_active_ = true;  // 变成活跃写者
-        --waiting_writers_;     // WriteLock 和 WriteUnlock 是一个组合, 在 WriteUnlock 最后 notify
+        auto start = profiler_.Now();
+        {
+            std::unique_lock lk{mtx_};
+            ++waiting_writers_;  // NOTE: 进入等待队列, 不是直接变成活跃, 因为还没获得锁!!
+            // 写者必须等待直到以下所有条件成立才可以写(体现: 写-读/写互斥)
+            //  * 没有正在活跃的写者 false
+            //  * 没有活跃读者 == 0
+            cv_can_write_.wait(lk, [this] { return !writer_active_ && reader_count_ == 0; });
+            writer_active_ = true;  // 变成活跃写者
+            --waiting_writers_;  // WriteLock 和 WriteUnlock 是一个组合, 在 WriteUnlock 最后 notify
+        }
+        profiler_.OnWriteAcquired(start);
     }
 
     // 释放写锁
     void WriteUnlock() {
+        auto sample = profiler_.OnWriteReleased();
         std::lock_guard lk{mtx_};
+        profiler_.RecordWrite(sample);
         writer_active_ = false;
         // 「写者优先」
         // 如果等待队列有等待的写者, 则优先唤醒一个写者
@@ -75,6 +298,1023 @@ public:
         }
     }
     // ===============================================================
+
+    // 竞争分析快照, 需要 -DRWLOCK_PROFILE=1
+    // NOTE: 写成模板让断言依赖模板参数, 只有真正调用 Profile() 时才检查
+    template <bool kEnabled = RWLOCK_PROFILE>
+    RWLockProfile Profile() {
+        static_assert(kEnabled, "Compile with -DRWLOCK_PROFILE=1 to enable RWLock::Profile().");
+        std::lock_guard lk{mtx_};
+        return profiler_.Snapshot();
+    }
 };
 
-int main() {}
\ No newline at end of file
+// 读可扩展的读写锁: 读者计数分散到多个缓存行上
+// RWLock 的每次 ReadLock/ReadUnlock 都要拿 mtx_, 读多写少时所有读者挤在同一条缓存行上排队,
+// 尽管读者之间本来并不冲突。这里把「活跃读者数」拆成 kReaderSlots 个独立缓存行上的计数器,
+// 每个线程固定用其中一个 (BRAVO / 分片计数器的思路):
+//   * 读者快路径: 自己的槽位 +1, 再看 writer_gate_; 没有写者就直接进入, 不碰任何共享缓存行
+//   * 写者: 在 mtx_ 下登记等待并打开 writer_gate_, 然后等所有槽位清零
+// 写者仍然优先: writer_gate_ 打开后新来的读者先把自己的 +1 撤回, 再在 cv_can_read_ 上等待,
+// 直到没有等待和活跃的写者; 已经进入的读者照常退出
+// NOTE: 读者「+1 后读 writer_gate_」与写者「写 writer_gate_ 后读各槽位」是 Dekker 式的握手,
+// 两边都必须是 seq_cst, 保证至少有一方看到对方:
+// 要么读者看到门已关而退让, 要么写者看到读者在场而等待
+// NOTE: 代价是写者要扫描所有槽位, 并且读者/写者交替频繁时慢路径要拿 mtx_; 适合读远多于写的场景
+
+class ShardedRWLock {
+public:
+    static constexpr std::size_t kReaderSlots = 64;
+
+private:
+    struct alignas(64) ReaderSlot {
+        std::atomic<int> count{0};
+    };
+
+    std::array<ReaderSlot, kReaderSlots> readers_;  // 各槽位上「活跃」的读者数量之和即读者总数
+    alignas(64) std::atomic<bool> writer_gate_{false};  // 有等待或活跃的写者时为 true
+
+    // 以下只在 mtx_ 下访问
+    int waiting_writers_{0};     // 「等待」的写者数量
+    bool writer_active_{false};  // 是否有活跃写者
+
+    std::mutex mtx_;
+    std::condition_variable cv_can_read_;   // 「读者可以读」: 写者全部离开
+    std::condition_variable cv_can_write_;  // 「写者可以写」: 读者清空且没有活跃写者
+
+public:
+    ShardedRWLock() = default;
+    ~ShardedRWLock() = default;
+    ShardedRWLock(ShardedRWLock const &) = delete;
+    ShardedRWLock(ShardedRWLock &&) = delete;
+
+public:
+    // ========================= 读上锁/解锁 =========================
+    void ReadLock() {
+        auto &slot = MySlot();
+        for (;;) {
+            slot.count.fetch_add(1, std::memory_order_seq_cst);
+            if (!writer_gate_.load(std::memory_order_seq_cst)) {
+                return;  // 快路径: 没有写者
+            }
+            // 慢路径: 撤回自己的 +1; 写者可能正好看到了它而在等待, 要叫醒它重新检查
+            slot.count.fetch_sub(1, std::memory_order_seq_cst);
+            std::unique_lock lk{mtx_};
+            cv_can_write_.notify_all();
+            cv_can_read_.wait(lk, [this] { return !writer_gate_.load(std::memory_order_relaxed); });
+        }
+    }
+
+    void ReadUnlock() {
+        MySlot().count.fetch_sub(1, std::memory_order_seq_cst);
+        // NOTE: 只有写者在等时才碰 mtx_; 减到 0 的未必是自己的槽位, 由写者在锁下重新数
+        if (writer_gate_.load(std::memory_order_seq_cst)) {
+            std::lock_guard lk{mtx_};
+            cv_can_write_.notify_all();
+        }
+    }
+    // ===============================================================
+
+    // ========================= 写上锁/解锁 =========================
+    void WriteLock() {
+        std::unique_lock lk{mtx_};
+        ++waiting_writers_;
+        writer_gate_.store(true, std::memory_order_seq_cst);  // 关门: 新读者不再进入
+        cv_can_write_.wait(lk, [this] { return !writer_active_ && NoReaders(); });
+        writer_active_ = true;
+        --waiting_writers_;
+    }
+
+    void WriteUnlock() {
+        std::lock_guard lk{mtx_};
+        writer_active_ = false;
+        // 「写者优先」: 还有等待的写者时门保持关闭, 交给下一个写者
+        if (waiting_writers_ > 0) {
+            cv_can_write_.notify_all();
+        } else {
+            writer_gate_.store(false, std::memory_order_seq_cst);
+            cv_can_read_.notify_all();
+        }
+    }
+    // ===============================================================
+
+private:
+    bool NoReaders() const {
+        for (const auto &slot : readers_) {
+            if (slot.count.load(std::memory_order_seq_cst) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 每个线程第一次用时按轮转分到一个槽位, 之后固定不变 (ReadUnlock 必须减同一个槽位)
+    // NOTE: 不用 sched_getcpu: 线程在 ReadLock 和 ReadUnlock 之间可能被迁移到别的 CPU
+    ReaderSlot &MySlot() {
+        static std::atomic<std::size_t> next_slot{0};
+        thread_local std::size_t index = next_slot.fetch_add(1, std::memory_order_relaxed);
+        return readers_[index % kReaderSlots];
+    }
+};
+
+#if defined(__linux__)
+
+// 基于 futex 的读写锁: 全部状态压在一个 32 位原子字里, 无竞争时加锁/解锁都只是一次 CAS/RMW
+// RWLock 的每次交接都要经过 mtx_ + 条件变量; 这里只有真的需要睡眠/唤醒时才进内核 (futex)
+//   state_ 的布局:
+//     bit 0~27  活跃读者数 (可升级读者也算一个读者)
+//     bit 28    kUpgradable: 有一个可升级读者 (同一时刻至多一个)
+//     bit 29    kWriter: 写锁被持有
+//     bit 30    kWritersWaiting: 有写者(或正在升级的读者)在等, 新读者不再进入 -> 写者优先
+//     bit 31    kReadersWaiting: 有读者/可升级读者睡在 state_ 上
+//   读者和可升级读者睡在 state_ 上, 写者睡在 writer_seq_ 上, 唤醒时可以只叫醒一个写者
+// 可升级读(upgradeable read): 与普通读者共存, 但与其他可升级读者和写者互斥; 持有期间可以原地升级为
+// 写锁 (等其他读者离开), 期间不会有别的写者插进来, 所以「读-判断-改」不用先放掉读锁再抢写锁
+// NOTE: 与 std::shared_lock / std::unique_lock 兼容 (lock / try_lock_for / lock_shared 等)
+// NOTE: 正在等待的写者(含正在升级的读者)数记在 writer_waiters_ 里; 最后一个等待的写者超时放弃时
+// 清除 kWritersWaiting 并唤醒读者, 不让一个已经不存在的写者继续挡住新读者
+class FutexRWLock {
+public:
+    FutexRWLock() = default;
+    ~FutexRWLock() = default;
+    FutexRWLock(FutexRWLock const &) = delete;
+    FutexRWLock(FutexRWLock &&) = delete;
+
+public:
+    // ========================= 读上锁/解锁 =========================
+    bool TryReadLock() {
+        uint32_t s = state_.load(std::memory_order_relaxed);
+        while (CanRead(s)) {
+            if (state_.compare_exchange_weak(s, s + kReader, std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ReadLock() {
+        if (!TryReadLock()) {
+            LockSharedSlow(0);
+        }
+    }
+
+    void ReadUnlock() {
+        uint32_t s = state_.fetch_sub(kReader, std::memory_order_release) - kReader;
+        if ((s & kReaderMask) == 0 && (s & (kWritersWaiting | kReadersWaiting)) != 0) {
+            WakeWriterOrReaders(s);
+        } else if ((s & kReaderMask) == 1 && (s & kUpgradable) && (s & kWritersWaiting)) {
+            // 只剩可升级读者自己, 它可能正在 Upgrade 里等; 和普通写者睡在一起, 只能全部叫醒
+            WakeWriters(INT_MAX);
+        }
+    }
+    // ===============================================================
+
+    // ========================= 写上锁/解锁 =========================
+    bool TryWriteLock() {
+        uint32_t s = state_.load(std::memory_order_relaxed);
+        while (CanWrite(s)) {
+            if (state_.compare_exchange_weak(s, s | kWriter, std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WriteLock() {
+        if (!TryWriteLock()) {
+            LockExclusiveSlow(nullptr);
+        }
+    }
+
+    // 在 timeout 内拿到写锁返回 true, 超时返回 false
+    template <typename Rep, typename Period>
+    bool TryWriteLockFor(const std::chrono::duration<Rep, Period> &timeout) {
+        return TryWriteLockUntil(std::chrono::steady_clock::now() + timeout);
+    }
+
+    template <typename Clock, typename Duration>
+    bool TryWriteLockUntil(const std::chrono::time_point<Clock, Duration> &deadline) {
+        if (TryWriteLock()) {
+            return true;
+        }
+        auto steady_deadline = std::chrono::steady_clock::now() + (deadline - Clock::now());
+        return LockExclusiveSlow(&steady_deadline);
+    }
+
+    void WriteUnlock() {
+        uint32_t s = state_.fetch_and(~kWriter, std::memory_order_release) & ~kWriter;
+        if (s & (kWritersWaiting | kReadersWaiting)) {
+            WakeWriterOrReaders(s);
+        }
+    }
+
+    // 写锁原地降级为读锁, 期间不会有别的写者插进来
+    void Downgrade() {
+        uint32_t s = state_.fetch_add(kReader - kWriter, std::memory_order_release);
+        if (s & kReadersWaiting) {
+            WakeReaders();
+        }
+    }
+    // ===============================================================
+
+    // ======================= 可升级读上锁/解锁 ======================
+    bool TryUpgradeLock() {
+        uint32_t s = state_.load(std::memory_order_relaxed);
+        while (CanUpgradeLock(s)) {
+            if (state_.compare_exchange_weak(s, s + kReader + kUpgradable,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void UpgradeLock() {
+        if (!TryUpgradeLock()) {
+            LockSharedSlow(kUpgradable);
+        }
+    }
+
+    void UpgradeUnlock() {
+        uint32_t s = state_.fetch_sub(kReader + kUpgradable, std::memory_order_release) -
+                     (kReader + kUpgradable);
+        if ((s & kReaderMask) == 0 && (s & (kWritersWaiting | kReadersWaiting)) != 0) {
+            WakeWriterOrReaders(s);
+        } else if (s & kReadersWaiting) {
+            WakeReaders();  // 可能有可升级读者在等 kUpgradable 被清除
+        }
+    }
+
+    // 可升级读 -> 写: 等其他读者离开; 等待期间新读者被挡住, 其他写者也拿不到锁
+    void Upgrade() {
+        bool registered = false;
+        uint32_t s = state_.load(std::memory_order_relaxed);
+        for (;;) {
+            if ((s & kReaderMask) == 1) {
+                uint32_t next = (s - kReader - kUpgradable) | kWriter;
+                if (state_.compare_exchange_weak(s, next, std::memory_order_acquire,
+                                                 std::memory_order_relaxed)) {
+                    if (registered) {
+                        writer_waiters_.fetch_sub(1, std::memory_order_seq_cst);
+                    }
+                    return;
+                }
+                continue;
+            }
+            if (!registered) {
+                writer_waiters_.fetch_add(1, std::memory_order_seq_cst);
+                registered = true;
+            }
+            if (!(s & kWritersWaiting)) {
+                if (!state_.compare_exchange_weak(s, s | kWritersWaiting,
+                                                  std::memory_order_relaxed)) {
+                    continue;
+                }
+                s |= kWritersWaiting;
+            }
+            uint32_t seq = writer_seq_.load(std::memory_order_acquire);
+            s = state_.load(std::memory_order_relaxed);
+            if ((s & kReaderMask) != 1 && (s & kWritersWaiting)) {
+                FutexWait(writer_seq_, seq, nullptr);
+                s = state_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryUpgrade() {
+        uint32_t s = state_.load(std::memory_order_relaxed);
+        while ((s & kReaderMask) == 1) {
+            if (state_.compare_exchange_weak(s, (s - kReader - kUpgradable) | kWriter,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    // ===============================================================
+
+    // std::unique_lock / std::shared_lock 要求的接口
+    void lock() { WriteLock(); }
+    bool try_lock() { return TryWriteLock(); }
+    void unlock() { WriteUnlock(); }
+    template <typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period> &timeout) {
+        return TryWriteLockFor(timeout);
+    }
+    template <typename Clock, typename Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration> &deadline) {
+        return TryWriteLockUntil(deadline);
+    }
+    void lock_shared() { ReadLock(); }
+    bool try_lock_shared() { return TryReadLock(); }
+    void unlock_shared() { ReadUnlock(); }
+
+private:
+    static constexpr uint32_t kReader = 1;
+    static constexpr uint32_t kReaderMask = (1u << 28) - 1;
+    static constexpr uint32_t kUpgradable = 1u << 28;
+    static constexpr uint32_t kWriter = 1u << 29;
+    static constexpr uint32_t kWritersWaiting = 1u << 30;
+    static constexpr uint32_t kReadersWaiting = 1u << 31;
+
+    // NOTE: kReadersWaiting 不挡读者, 它只表示「解锁时要去 state_ 上叫人」
+    static bool CanRead(uint32_t s) { return (s & (kWriter | kWritersWaiting)) == 0; }
+    static bool CanUpgradeLock(uint32_t s) { return CanRead(s) && (s & kUpgradable) == 0; }
+    static bool CanWrite(uint32_t s) { return (s & (kReaderMask | kWriter | kUpgradable)) == 0; }
+
+    // 读者 (upgradable == 0) 或可升级读者 (upgradable == kUpgradable) 的慢路径
+    void LockSharedSlow(uint32_t upgradable) {
+        uint32_t s = state_.load(std::memory_order_relaxed);
+        for (;;) {
+            bool ok = upgradable ? CanUpgradeLock(s) : CanRead(s);
+            if (ok) {
+                if (state_.compare_exchange_weak(s, s + kReader + upgradable,
+                                                 std::memory_order_acquire,
+                                                 std::memory_order_relaxed)) {
+                    return;
+                }
+                continue;
+            }
+            if (!(s & kReadersWaiting)) {
+                if (!state_.compare_exchange_weak(s, s | kReadersWaiting,
+                                                  std::memory_order_relaxed)) {
+                    continue;
+                }
+                s |= kReadersWaiting;
+            }
+            FutexWait(state_, s, nullptr);  // state_ 变了就立即返回, 不会错过唤醒
+            s = state_.load(std::memory_order_relaxed);
+        }
+    }
+
+    // deadline 为 nullptr 时一直等; 超时返回 false
+    bool LockExclusiveSlow(const std::chrono::steady_clock::time_point *deadline) {
+        // NOTE: 被唤醒的写者清掉了 kWritersWaiting, 但可能还有别的写者在等, 拿锁时保守地把它带回去
+        uint32_t other_writers = 0;
+        bool registered = false;
+        uint32_t s = state_.load(std::memory_order_relaxed);
+        for (;;) {
+            if (CanWrite(s)) {
+                if (state_.compare_exchange_weak(s, s | kWriter | other_writers,
+                                                 std::memory_order_acquire,
+                                                 std::memory_order_relaxed)) {
+                    if (registered) {
+                        writer_waiters_.fetch_sub(1, std::memory_order_seq_cst);
+                    }
+                    return true;
+                }
+                continue;
+            }
+            if (!registered) {
+                writer_waiters_.fetch_add(1, std::memory_order_seq_cst);
+                registered = true;
+            }
+            if (!(s & kWritersWaiting)) {
+                if (!state_.compare_exchange_weak(s, s | kWritersWaiting,
+                                                  std::memory_order_relaxed)) {
+                    continue;
+                }
+            }
+            other_writers = kWritersWaiting;
+            // 先读 writer_seq_ 再确认状态: 之后的唤醒一定会改变 writer_seq_, FutexWait 不会睡过头
+            uint32_t seq = writer_seq_.load(std::memory_order_acquire);
+            s = state_.load(std::memory_order_relaxed);
+            if (!CanWrite(s) && (s & kWritersWaiting)) {
+                if (!FutexWait(writer_seq_, seq, deadline)) {
+                    if (writer_waiters_.fetch_sub(1, std::memory_order_seq_cst) == 1) {
+                        ClearWritersWaiting();
+                    }
+                    return false;
+                }
+                s = state_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 锁刚变成无人持有(或只剩等待标志): 优先交给一个写者, 没有写者可叫时唤醒所有读者
+    void WakeWriterOrReaders(uint32_t s) {
+        while (s & kWritersWaiting) {
+            if (s & (kReaderMask | kWriter | kUpgradable)) {
+                return;  // 新写者抢到了锁, 交给它解锁时处理; 读者此时本来也进不来
+            }
+            if (state_.compare_exchange_weak(s, s & ~kWritersWaiting, std::memory_order_relaxed)) {
+                if (WakeWriters(1) > 0) {
+                    return;  // 读者留给这个写者解锁时唤醒
+                }
+                s &= ~kWritersWaiting;  // 等待的写者已超时离开, 转而唤醒读者
+            }
+        }
+        if (s & kReadersWaiting) {
+            WakeReaders();
+        }
+    }
+
+    // 最后一个等待的写者超时离开: 放行被 kWritersWaiting 挡住的读者
+    void ClearWritersWaiting() {
+        uint32_t s = state_.load(std::memory_order_relaxed);
+        while ((s & kWritersWaiting) &&
+               !state_.compare_exchange_weak(s, s & ~kWritersWaiting, std::memory_order_relaxed)) {
+        }
+        // NOTE: 可能有新写者刚刚登记、正要睡下而它的标志被这里清掉了; 推进 writer_seq_ 让它醒来
+        // 重新检查并把标志设回去, 否则它会在没有标志的情况下睡下, 再也没人唤醒
+        WakeWriters(INT_MAX);
+        WakeReaders();
+    }
+
+    long WakeWriters(int count) {
+        writer_seq_.fetch_add(1, std::memory_order_release);
+        return FutexWake(writer_seq_, count);
+    }
+
+    void WakeReaders() {
+        state_.fetch_and(~kReadersWaiting, std::memory_order_relaxed);
+        FutexWake(state_, INT_MAX);
+    }
+
+    // 值仍是 expected 时睡眠; 超时返回 false, 被唤醒/值已改变/被信号打断返回 true
+    static bool FutexWait(std::atomic<uint32_t> &word, uint32_t expected,
+                          const std::chrono::steady_clock::time_point *deadline) {
+        timespec ts{};
+        timespec *timeout = nullptr;
+        if (deadline) {
+            auto left = *deadline - std::chrono::steady_clock::now();
+            if (left <= std::chrono::steady_clock::duration::zero()) {
+                return false;
+            }
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+            ts.tv_sec = static_cast<time_t>(ns / 1'000'000'000);
+            ts.tv_nsec = static_cast<long>(ns % 1'000'000'000);
+            timeout = &ts;
+        }
+        long rc = syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE,
+                          expected, timeout, nullptr, 0);
+        return !(rc == -1 && errno == ETIMEDOUT);
+    }
+
+    static long FutexWake(std::atomic<uint32_t> &word, int count) {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE, count,
+                       nullptr, nullptr, 0);
+    }
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+    std::atomic<uint32_t> state_{0};
+    std::atomic<uint32_t> writer_seq_{0};      // 写者的唤醒序号, 写者睡在它上面
+    std::atomic<uint32_t> writer_waiters_{0};  // 正在等待的写者数 (含正在升级的读者)
+};
+
+// 可升级读锁的 RAII 守卫: 析构时按当前模式(可升级读 / 写)解锁
+class UpgradeGuard {
+public:
+    explicit UpgradeGuard(FutexRWLock &lock) : lock_(lock) { lock_.UpgradeLock(); }
+    ~UpgradeGuard() {
+        if (upgraded_) {
+            lock_.WriteUnlock();
+        } else {
+            lock_.UpgradeUnlock();
+        }
+    }
+    UpgradeGuard(UpgradeGuard const &) = delete;
+    UpgradeGuard &operator=(UpgradeGuard const &) = delete;
+
+    void Upgrade() {
+        if (!upgraded_) {
+            lock_.Upgrade();
+            upgraded_ = true;
+        }
+    }
+
+    bool Upgraded() const { return upgraded_; }
+
+private:
+    FutexRWLock &lock_;
+    bool upgraded_{false};
+};
+
+#endif  // __linux__
+
+// 顺序锁(seqlock): 读者完全不写共享内存, 适合很小、读极多写极少的数据 (如配置)
+// 写者: 序号 +1 (变奇数) -> 写数据 -> 序号 +1 (变偶数); 写者之间用 write_mtx_ 串行
+// 读者: 读序号(偶数) -> 拷贝数据 -> 再读序号, 两次相同说明拷贝期间没有写者, 否则重来
+// 读者从不阻塞写者, 写者也不等读者; 代价是读者在写的瞬间要重试, 且只能拷贝出一份副本
+// NOTE: 数据按 8 字节切成 atomic 字, 用 relaxed 读写: 拷贝可能与写者并发, 普通内存读写是数据竞争
+// (未定义行为), relaxed atomic 在 x86/ARM 上就是普通的 mov/ldr, 没有额外开销
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock 只能保存可平凡拷贝的类型");
+
+public:
+    SeqLock() : SeqLock(T{}) {}
+    explicit SeqLock(const T &value) { StoreWords(value); }
+    SeqLock(SeqLock const &) = delete;
+    SeqLock(SeqLock &&) = delete;
+
+    // 返回一份一致的快照
+    T Read() const {
+        for (;;) {
+            uint64_t begin = seq_.load(std::memory_order_acquire);
+            if (begin & 1) {
+                std::this_thread::yield();  // 写者正在写
+                continue;
+            }
+            uint64_t buf[kWords];
+            for (std::size_t i = 0; i < kWords; ++i) {
+                buf[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            // NOTE: acquire 栅栏保证上面的数据读不会被重排到下面的序号读之后
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == begin) {
+                T out;
+                std::memcpy(&out, buf, sizeof(T));
+                return out;
+            }
+        }
+    }
+
+    void Write(const T &value) {
+        std::lock_guard lk{write_mtx_};
+        StoreWords(value);
+    }
+
+    // 读-改-写: f(T&) 修改当前值的副本后整体写回, 多个写者之间不会丢失更新
+    template <typename F>
+    void Update(F &&f) {
+        std::lock_guard lk{write_mtx_};
+        T value = Read();
+        std::forward<F>(f)(value);
+        StoreWords(value);
+    }
+
+private:
+    static constexpr std::size_t kWords = (sizeof(T) + 7) / 8;
+
+    void StoreWords(const T &value) {
+        uint64_t buf[kWords] = {};
+        std::memcpy(buf, &value, sizeof(T));
+        uint64_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        // NOTE: release 栅栏保证奇数序号先于下面的数据写被读者看到
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < kWords; ++i) {
+            words_[i].store(buf[i], std::memory_order_relaxed);
+        }
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    alignas(64) std::atomic<uint64_t> seq_{0};
+    std::atomic<uint64_t> words_[kWords];
+    std::mutex write_mtx_;
+};
+
+// RCU 风格的快照单元: 读者拿到当前版本的指针直接读, 写者复制一份改好后整体替换指针,
+// 等所有可能还在读旧版本的读者离开(宽限期, grace period)后再释放旧版本
+// 与 SeqLock 相比: T 可以是任意类型 (string / vector / map), 读者读的是原对象而不是副本, 也不会重试
+// 宽限期用 SRCU 的做法: 读者计数分两组, epoch_ 的奇偶决定新读者进哪一组;
+// 写者翻转 epoch_ 后等旧的一组清零, 再翻一次等另一组清零, 就能保证替换前进入的读者都已离开
+// NOTE: 读者只写自己分到的计数器 (和 ShardedRWLock 一样按线程分散到独立缓存行), 不写任何被其他
+// 读者共享的缓存行; 写者要等宽限期, 所以只适合写很少的场景
+template <typename T>
+class RcuCell {
+public:
+    static constexpr std::size_t kReaderSlots = 64;
+
+    template <typename... Args>
+    explicit RcuCell(Args &&...args) : current_(new T(std::forward<Args>(args)...)) {}
+    ~RcuCell() { delete current_.load(std::memory_order_relaxed); }
+    RcuCell(RcuCell const &) = delete;
+    RcuCell(RcuCell &&) = delete;
+
+    // 在读侧临界区内调用 f(const T&) 并返回其结果; f 里不能保留指向 T 的引用
+    template <typename F>
+    decltype(auto) Read(F &&f) const {
+        auto &slot = MySlot(epoch_.load(std::memory_order_seq_cst) & 1);
+        slot.count.fetch_add(1, std::memory_order_seq_cst);
+        struct Exit {
+            std::atomic<int> &count;
+            ~Exit() { count.fetch_sub(1, std::memory_order_release); }
+        } exit{slot.count};
+        return std::forward<F>(f)(*current_.load(std::memory_order_seq_cst));
+    }
+
+    T Snapshot() const {
+        return Read([](const T &value) { return value; });
+    }
+
+    void Store(T value) {
+        std::lock_guard lk{write_mtx_};
+        Replace(new T(std::move(value)));
+    }
+
+    // 读-改-写: f(T&) 修改当前值的副本后整体替换
+    template <typename F>
+    void Update(F &&f) {
+        std::lock_guard lk{write_mtx_};
+        auto *copy = new T(*current_.load(std::memory_order_relaxed));
+        std::forward<F>(f)(*copy);
+        Replace(copy);
+    }
+
+private:
+    struct alignas(64) ReaderSlot {
+        std::atomic<int> count{0};
+    };
+
+    void Replace(T *next) {
+        T *old = current_.exchange(next, std::memory_order_seq_cst);
+        Synchronize();
+        delete old;
+    }
+
+    // 等待宽限期: 替换指针之前进入的读者都已离开
+    void Synchronize() {
+        for (int round = 0; round < 2; ++round) {
+            uint64_t idx = epoch_.fetch_add(1, std::memory_order_seq_cst) & 1;
+            while (!Drained(idx)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool Drained(uint64_t idx) const {
+        for (const auto &slot : readers_[idx]) {
+            if (slot.count.load(std::memory_order_seq_cst) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ReaderSlot &MySlot(uint64_t idx) const {
+        static std::atomic<std::size_t> next_slot{0};
+        thread_local std::size_t index = next_slot.fetch_add(1, std::memory_order_relaxed);
+        return readers_[idx][index % kReaderSlots];
+    }
+
+    std::atomic<T *> current_;
+    alignas(64) std::atomic<uint64_t> epoch_{0};
+    mutable std::array<std::array<ReaderSlot, kReaderSlots>, 2> readers_;
+    std::mutex write_mtx_;
+};
+
+// --- 测试与基准测试 ---
+
+// 把 ReadLock/WriteLock 风格和 std::shared_mutex 统一起来
+template <typename Lock>
+struct LockOps {
+    static void Read(Lock &lock) { lock.ReadLock(); }
+    static void ReadDone(Lock &lock) { lock.ReadUnlock(); }
+    static void Write(Lock &lock) { lock.WriteLock(); }
+    static void WriteDone(Lock &lock) { lock.WriteUnlock(); }
+};
+
+template <>
+struct LockOps<std::shared_mutex> {
+    static void Read(std::shared_mutex &lock) { lock.lock_shared(); }
+    static void ReadDone(std::shared_mutex &lock) { lock.unlock_shared(); }
+    static void Write(std::shared_mutex &lock) { lock.lock(); }
+    static void WriteDone(std::shared_mutex &lock) { lock.unlock(); }
+};
+
+// 写者把 a/b 同时 +1, 读者检查 a == b; 返回读者看到不一致的次数
+template <typename Lock>
+int CheckConsistency(int threads, int ops) {
+    Lock lock;
+    long a = 0, b = 0;
+    std::atomic<int> torn{0};
+    {
+        std::vector<std::jthread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = 0; i < ops; ++i) {
+                    if ((i + t) % 10 == 0) {
+                        LockOps<Lock>::Write(lock);
+                        ++a;
+                        ++b;
+                        LockOps<Lock>::WriteDone(lock);
+                    } else {
+                        LockOps<Lock>::Read(lock);
+                        if (a != b) {
+                            torn.fetch_add(1);
+                        }
+                        LockOps<Lock>::ReadDone(lock);
+                    }
+                }
+            });
+        }
+    }
+    return torn.load() + static_cast<int>(a != b);
+}
+
+#if defined(__linux__)
+// 混合所有加锁方式: 读 / 写 / 限时写 / 可升级读(一部分升级) / 写后降级
+// 写者把 a/b 同时 +1; 返回 (读者看到不一致的次数 + 最终计数与成功写入次数的差)
+int CheckFutexRWLock(int threads, int ops) {
+    FutexRWLock lock;
+    long a = 0, b = 0;
+    std::atomic<long> writes{0};
+    std::atomic<int> bad{0};
+    {
+        std::vector<std::jthread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = 0; i < ops; ++i) {
+                    switch ((i + t) % 8) {
+                        case 0: {
+                            std::unique_lock lk{lock};
+                            ++a, ++b, ++writes;
+                            break;
+                        }
+                        case 1: {
+                            std::unique_lock lk{lock, std::chrono::microseconds{50}};
+                            if (lk.owns_lock()) {
+                                ++a, ++b, ++writes;
+                            }
+                            break;
+                        }
+                        case 2: {
+                            UpgradeGuard guard{lock};
+                            if (a != b) {
+                                bad.fetch_add(1);
+                            }
+                            if (a % 2 == 0) {  // 读-判断-改: 判断和修改之间不会有别的写者
+                                guard.Upgrade();
+                                ++a, ++b, ++writes;
+                            }
+                            break;
+                        }
+                        case 3: {
+                            lock.WriteLock();
+                            ++a, ++b, ++writes;
+                            lock.Downgrade();
+                            if (a != b) {
+                                bad.fetch_add(1);
+                            }
+                            lock.ReadUnlock();
+                            break;
+                        }
+                        default: {
+                            std::shared_lock lk{lock};
+                            if (a != b) {
+                                bad.fetch_add(1);
+                            }
+                            break;
+                        }
+                    }
+                }
+            });
+        }
+    }
+    return bad.load() + static_cast<int>(a != b) + static_cast<int>(a != writes.load());
+}
+
+// 长时间持有读锁时, 限时写者超时后: 睡在 ReadLock 里的读者应立即进入 (不必等读锁释放);
+// 但只要还有别的写者在等, 新读者仍被挡住 (写者优先)
+bool CheckTimedWriterReleasesReaders() {
+    using namespace std::chrono_literals;
+    FutexRWLock lock;
+    std::shared_lock holder{lock};
+
+    std::atomic<bool> reader_in{false};
+    std::jthread timed_writer{[&] { (void)lock.TryWriteLockFor(50ms); }};
+    std::this_thread::sleep_for(10ms);  // 让写者先登记, 读者才会被挡住
+    std::jthread reader{[&] {
+        std::shared_lock lk{lock};
+        reader_in = true;
+    }};
+    timed_writer.join();
+    auto deadline = std::chrono::steady_clock::now() + 1s;
+    while (!reader_in && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    bool released = reader_in.load();
+    reader.join();
+
+    // 一个写者超时、另一个仍在等: 读者不能进入
+    std::jthread patient_writer{[&] { std::unique_lock lk{lock}; }};
+    std::jthread impatient_writer{[&] { (void)lock.TryWriteLockFor(20ms); }};
+    std::this_thread::sleep_for(60ms);
+    bool still_blocked = !lock.TryReadLock();
+    if (!still_blocked) {
+        lock.ReadUnlock();
+    }
+    holder.unlock();  // 放行 patient_writer
+    return released && still_blocked;
+}
+#endif
+
+// 读多写少: 每 write_every 次操作有一次写; 返回每秒完成的操作数(百万)
+template <typename Lock>
+double BenchReadHeavy(int threads, int ops_per_thread, int write_every) {
+    Lock lock;
+    std::array<long, 8> data{};  // 读者求和, 写者逐个 +1
+    std::atomic<long> sink{0};
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::vector<std::jthread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                long local = 0;
+                for (int i = 0; i < ops_per_thread; ++i) {
+                    if ((i + t * 7) % write_every == 0) {
+                        LockOps<Lock>::Write(lock);
+                        for (auto &v : data) {
+                            ++v;
+                        }
+                        LockOps<Lock>::WriteDone(lock);
+                    } else {
+                        LockOps<Lock>::Read(lock);
+                        for (auto v : data) {
+                            local += v;
+                        }
+                        LockOps<Lock>::ReadDone(lock);
+                    }
+                }
+                sink.fetch_add(local, std::memory_order_relaxed);
+            });
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(threads) * ops_per_thread / elapsed.count() / 1e6;
+}
+
+// 读多写少的共享配置: 写者把所有字段设为同一个版本号, 读者检查字段是否一致
+struct Config {
+    int64_t version = 0;
+    int64_t fields[7] = {};
+};
+
+Config MakeConfig(int64_t version) {
+    Config config{version, {}};
+    std::fill(std::begin(config.fields), std::end(config.fields), version);
+    return config;
+}
+
+bool IsConsistent(const Config &config) {
+    return std::all_of(std::begin(config.fields), std::end(config.fields),
+                       [&](int64_t v) { return v == config.version; });
+}
+
+// 用读写锁保护的 Config, 与 SeqLock / RcuCell 提供相同的 Read / Write
+template <typename Lock>
+class LockedConfig {
+public:
+    Config Read() {
+        LockOps<Lock>::Read(lock_);
+        Config out = config_;
+        LockOps<Lock>::ReadDone(lock_);
+        return out;
+    }
+
+    void Write(const Config &config) {
+        LockOps<Lock>::Write(lock_);
+        config_ = config;
+        LockOps<Lock>::WriteDone(lock_);
+    }
+
+private:
+    Lock lock_;
+    Config config_;
+};
+
+class RcuConfig {
+public:
+    Config Read() { return cell_.Snapshot(); }
+    void Write(const Config &config) { cell_.Store(config); }
+
+private:
+    RcuCell<Config> cell_;
+};
+
+// 1 个写者每隔 write_interval 发布一个新版本, threads 个读者不停读; 返回读者每秒的读取数(百万)
+// 读到不一致的快照时计入 torn
+template <typename Cell>
+double BenchConfigReads(int threads, int reads_per_thread, std::chrono::microseconds write_interval,
+                        int &torn) {
+    Cell cell;
+    std::atomic<bool> done{false};
+    std::atomic<int> bad{0};
+    std::chrono::duration<double> elapsed{};
+    {
+        std::jthread writer{[&] {
+            for (int64_t version = 1; !done.load(std::memory_order_relaxed); ++version) {
+                cell.Write(MakeConfig(version));
+                std::this_thread::sleep_for(write_interval);
+            }
+        }};
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::vector<std::jthread> readers;
+            for (int t = 0; t < threads; ++t) {
+                readers.emplace_back([&] {
+                    for (int i = 0; i < reads_per_thread; ++i) {
+                        if (!IsConsistent(cell.Read())) {
+                            bad.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                });
+            }
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        done.store(true);
+    }
+    torn += bad.load();
+    return static_cast<double>(threads) * reads_per_thread / elapsed.count() / 1e6;
+}
+
+int main() {
+    std::cout << "--- consistency (8 threads, 10% writes), torn reads ---\n";
+    std::cout << "RWLock\t\t" << CheckConsistency<RWLock>(8, 20'000) << "\n";
+    std::cout << "ShardedRWLock\t" << CheckConsistency<ShardedRWLock>(8, 20'000) << "\n";
+#if defined(__linux__)
+    std::cout << "FutexRWLock\t" << CheckConsistency<FutexRWLock>(8, 20'000) << "\n";
+    std::cout << "FutexRWLock (read/write/timed/upgrade/downgrade, 16 threads)\t"
+              << CheckFutexRWLock(16, 20'000) << "\n";
+    {
+        FutexRWLock lock;
+        std::shared_lock reader{lock};
+        auto start = std::chrono::steady_clock::now();
+        bool got = lock.TryWriteLockFor(std::chrono::milliseconds{20});
+        auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        bool second_reader = lock.TryReadLock();  // 超时的写者不应再挡住新读者
+        std::cout << "TryWriteLockFor(20ms) while read-locked: " << (got ? "acquired" : "timed out")
+                  << " after " << waited.count() << "ms, TryReadLock: "
+                  << (second_reader ? "ok" : "blocked by stale waiting-writer flag") << "\n";
+        if (second_reader) {
+            lock.ReadUnlock();
+        }
+    }
+    std::cout << "blocked reader admitted after the only waiting writer timed out: "
+              << (CheckTimedWriterReleasesReaders() ? "yes" : "no") << "\n";
+#endif
+
+#if RWLOCK_PROFILE
+    std::cout << "\n--- RWLock profile (8 threads, 1 write per 10 ops) ---\n";
+    {
+        RWLock lock;
+        long value = 0;
+        {
+            std::vector<std::jthread> workers;
+            for (int t = 0; t < 8; ++t) {
+                workers.emplace_back([&, t] {
+                    for (int i = 0; i < 20'000; ++i) {
+                        if ((i + t) % 10 == 0) {
+                            lock.WriteLock();
+                            ++value;
+                            lock.WriteUnlock();
+                        } else {
+                            lock.ReadLock();
+                            [[maybe_unused]] volatile long v = value;
+                            lock.ReadUnlock();
+                        }
+                    }
+                });
+            }
+        }
+        lock.Profile().Print(std::cout);
+    }
+#endif
+
+    constexpr int kOps = 200'000;
+    for (int write_every : {1000, 100, 10}) {
+        std::cout << "\n--- Benchmark: 1 write per " << write_every
+                  << " ops, M ops/s (" << kOps << " ops per thread) ---\n";
+        std::cout << "threads\tRWLock\t\tShardedRWLock\tshared_mutex\tFutexRWLock\n";
+        for (int threads = 1; threads <= 64; threads *= 2) {
+            std::cout << threads << '\t' << BenchReadHeavy<RWLock>(threads, kOps, write_every)
+                      << "\t\t" << BenchReadHeavy<ShardedRWLock>(threads, kOps, write_every)
+                      << "\t\t" << BenchReadHeavy<std::shared_mutex>(threads, kOps, write_every)
+#if defined(__linux__)
+                      << "\t\t" << BenchReadHeavy<FutexRWLock>(threads, kOps, write_every)
+#endif
+                      << "\n";
+        }
+    }
+
+    constexpr int kReads = 200'000;
+    constexpr std::chrono::microseconds kWriteInterval{100};
+    int torn = 0;
+    std::cout << "\n--- Benchmark: shared Config (64B), 1 writer every " << kWriteInterval.count()
+              << "us, M reads/s (" << kReads << " reads per reader) ---\n";
+    std::cout << "readers\tRWLock\tSharded\tshared_mutex\tSeqLock\tRcuCell\n";
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        std::cout << threads << '\t'
+                  << BenchConfigReads<LockedConfig<RWLock>>(threads, kReads, kWriteInterval, torn)
+                  << '\t'
+                  << BenchConfigReads<LockedConfig<ShardedRWLock>>(threads, kReads, kWriteInterval,
+                                                                   torn)
+                  << '\t'
+                  << BenchConfigReads<LockedConfig<std::shared_mutex>>(threads, kReads,
+                                                                       kWriteInterval, torn)
+                  << "\t\t"
+                  << BenchConfigReads<SeqLock<Config>>(threads, kReads, kWriteInterval, torn)
+                  << '\t' << BenchConfigReads<RcuConfig>(threads, kReads, kWriteInterval, torn)
+                  << "\n";
+    }
+    std::cout << "torn reads: " << torn << "\n";
+    return 0;
+}
\ No newline at end of file